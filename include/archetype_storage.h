@@ -0,0 +1,138 @@
+#pragma once
+
+#include "types.h"
+#include "component_type.h"
+#include "memory_resource.h"
+#include "utility.h"
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <memory>
+#include <vector>
+
+namespace ecs {
+
+  // type erased operations on a component type
+  struct column_info {
+    size_t size;
+    size_t align;
+    void ( *move_construct )( void* dst, void* src );
+    void ( *destroy )( void* p );
+
+    template < typename T >
+    static const column_info& of();
+  };
+
+  // storage which groups entities with identical component sets (archetypes)
+  // into chunks, every chunk keeps one contiguous array per component type;
+  // adding or removing a component moves the entity to another archetype and
+  // invalidates references to its components; chunks and the id to location
+  // table are drawn from resource, which must outlive the storage
+  class archetype_storage {
+  public:
+    static const size_t chunk_bytes = 16 * 1024;
+
+    explicit archetype_storage( memory_resource* resource = new_delete_resource() );
+    ~archetype_storage();
+
+    archetype_storage( const archetype_storage& ) = delete;
+    archetype_storage& operator= ( const archetype_storage& ) = delete;
+
+    /* modify */
+    template < typename T, typename... Ts >
+    T& add( const eid_t id, Ts&&... ts );
+
+    template < typename T >
+    T& set( const eid_t id, const T& t );
+
+    template < typename T >
+    void remove( const eid_t id );
+
+    void remove_all( const eid_t id );
+
+    /* access */
+    template < typename T >
+    T* get( const eid_t id ) const;
+
+    // f( id, components... ) for every entity having all of Ts and none of TsEx,
+    // f may add or remove components of the entity it is called for
+    template < typename... Ts, typename... TsEx, typename Ft >
+    void join( type_list< TsEx... >, Ft&& f );
+
+    // f( ids, arrays..., n ) for every non-empty chunk of matching archetypes,
+    // f must not add or remove components
+    template < typename... Ts, typename... TsEx, typename Ft >
+    void join_batch( type_list< TsEx... >, Ft&& f );
+
+    size_t archetype_count() const;
+
+  private:
+    struct chunk {
+      void*  data;
+      eid_t* ids;
+      size_t size;
+    };
+
+    struct archetype {
+      std::vector< size_t >                   types;     // sorted component ids
+      std::vector< const column_info* >       columns;
+      std::vector< size_t >                   offsets;   // column offsets within a chunk
+      std::vector< size_t >                   column_of; // component id -> column + 1, 0 if absent
+      std::vector< std::unique_ptr< chunk > > chunks;
+      size_t                                  capacity;  // rows per chunk
+      size_t                                  chunk_size;
+      size_t                                  chunk_align;
+      std::map< size_t, archetype* >          add_edges;
+      std::map< size_t, archetype* >          remove_edges;
+
+      bool has( const size_t type ) const;
+      size_t row_count() const;
+      void* data( chunk& ch, const size_t column, const size_t row ) const;
+    };
+
+    struct location {
+      archetype* arch;
+      size_t     chunk;
+      size_t     row;
+    };
+
+    // archetype has all of Ts and none of TsEx
+    template < typename... Ts, typename... TsEx >
+    static bool matches( const archetype& arch, type_list< TsEx... > );
+
+    // f for the first count rows of arch, chunks are kept densely filled
+    template < typename... Ts, typename Ft, size_t... Is >
+    void join_rows( archetype& arch, const size_t count, Ft& f, index_sequence< Is... > );
+
+    template < typename T >
+    T* column_base( archetype& arch, chunk& ch ) const;
+
+    const location* find( const eid_t id ) const;
+
+    archetype* find_or_create( const std::vector< size_t >& types );
+    archetype* with( archetype* arch, const size_t type );
+    archetype* without( archetype* arch, const size_t type );
+
+    void register_column( const size_t type, const column_info& info );
+
+    location allocate_row( archetype& arch, const eid_t id );
+
+    // move components of id shared with target into the row at dst,
+    // destroy the rest and release the old row
+    void migrate( const eid_t id, const location* dst );
+
+    // release a row which components are already moved out or destroyed
+    void release_row( const location& loc );
+
+    void free_chunk( const archetype& arch, chunk& ch );
+
+    memory_resource*                            m_resource;
+    std::vector< std::unique_ptr< archetype > > m_archetypes;
+    std::map< std::vector< size_t >, archetype* > m_archetypeIndex;
+    std::vector< const column_info* >           m_columns;
+    std::vector< location, resource_allocator< location > > m_locations;
+  };
+}
+
+#include "archetype_storage.hpp"
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cassert>
+#include <new>
+#include <tuple>
+#include <utility>
+
+namespace ecs {
+
+//=============================================================================
+//
+// column_info
+//
+//=============================================================================
+template < typename T >
+const column_info& column_info::of() {
+  static_assert( alignof( T ) <= alignof( std::max_align_t ), "over-aligned components are not supported" );
+
+  static const column_info info = {
+    sizeof( T ),
+    alignof( T ),
+    []( void* dst, void* src ) {
+      new( dst ) T( std::move( *static_cast< T* >( src ) ) );
+    },
+    []( void* p ) {
+      static_cast< T* >( p )->~T();
+    }
+  };
+
+  return info;
+}
+
+//=============================================================================
+//
+// archetype_storage
+//
+//=============================================================================
+template < typename T, typename... Ts >
+T& archetype_storage::add( const eid_t id, Ts&&... ts ) {
+  T* existing = get< T >( id );
+  if ( existing ) {
+    return *existing;
+  }
+
+  const size_t type = component_type< T >::id;
+  register_column( type, column_info::of< T >() );
+
+  const location* src = find( id );
+  archetype* target = with( src ? src->arch : nullptr, type );
+  const location dst = allocate_row( *target, id );
+
+  T* result( nullptr );
+  try {
+    void* place = target->data( *target->chunks[ dst.chunk ], target->column_of[ type ] - 1, dst.row );
+    result = new( place ) T( std::forward< Ts >( ts )... );
+  } catch ( ... ) {
+    release_row( dst );
+    throw;
+  }
+
+  migrate( id, &dst );
+
+  return *result;
+}
+
+template < typename T >
+T& archetype_storage::set( const eid_t id, const T& t ) {
+  T* existing = get< T >( id );
+  if ( existing ) {
+    return *existing = t;
+  }
+
+  return add< T >( id, t );
+}
+
+template < typename T >
+void archetype_storage::remove( const eid_t id ) {
+  const size_t type = component_type< T >::id;
+  const location* src = find( id );
+  if ( !src || !src->arch->has( type ) ) {
+    return;
+  }
+
+  archetype* target = without( src->arch, type );
+  if ( target ) {
+    const location dst = allocate_row( *target, id );
+    migrate( id, &dst );
+  } else {
+    migrate( id, nullptr );
+  }
+}
+
+template < typename T >
+T* archetype_storage::get( const eid_t id ) const {
+  const size_t type = component_type< T >::id;
+  const location* loc = find( id );
+  if ( !loc || !loc->arch->has( type ) ) {
+    return nullptr;
+  }
+
+  archetype& arch = *loc->arch;
+  return static_cast< T* >( arch.data( *arch.chunks[ loc->chunk ], arch.column_of[ type ] - 1, loc->row ) );
+}
+
+template < typename... Ts, typename... TsEx, typename Ft >
+void archetype_storage::join( type_list< TsEx... > excluded, Ft&& f ) {
+  // rows appended while joining belong to entities which are already
+  // visited, so only rows existing up front are walked
+  std::vector< std::pair< archetype*, size_t > > matched;
+  for ( const auto& arch : m_archetypes ) {
+    if ( matches< Ts... >( *arch, excluded ) && !arch->chunks.empty() ) {
+      matched.emplace_back( arch.get(), arch->row_count() );
+    }
+  }
+
+  for ( const auto& m : matched ) {
+    join_rows< Ts... >( *m.first, m.second, f, make_index_sequence< sizeof...( Ts ) >() );
+  }
+}
+
+template < typename... Ts, typename... TsEx, typename Ft >
+void archetype_storage::join_batch( type_list< TsEx... > excluded, Ft&& f ) {
+  for ( const auto& arch : m_archetypes ) {
+    if ( !matches< Ts... >( *arch, excluded ) ) {
+      continue;
+    }
+
+    for ( const auto& ch : arch->chunks ) {
+      f( static_cast< const eid_t* >( ch->ids ), column_base< Ts >( *arch, *ch )..., ch->size );
+    }
+  }
+}
+
+template < typename... Ts, typename... TsEx >
+bool archetype_storage::matches( const archetype& arch, type_list< TsEx... > ) {
+  const size_t include[] = { component_type< Ts >::id... };
+  // leading dummy keeps the array non-empty
+  const size_t exclude[] = { 0, component_type< TsEx >::id... };
+
+  bool match = true;
+  for ( const auto t : include ) {
+    match = match && arch.has( t );
+  }
+
+  for ( size_t i = 1; i < sizeof( exclude ) / sizeof( exclude[ 0 ] ); ++i ) {
+    match = match && !arch.has( exclude[ i ] );
+  }
+
+  return match;
+}
+
+template < typename... Ts, typename Ft, size_t... Is >
+void archetype_storage::join_rows( archetype& arch, const size_t count, Ft& f, index_sequence< Is... > ) {
+  std::tuple< Ts*... > bases;
+  const void* data( nullptr );
+
+  // walk backwards, a row filled by swap-remove comes from the tail,
+  // which is either visited already or appended during the join
+  for ( size_t i = count; i > 0; --i ) {
+    const size_t row = ( i - 1 ) % arch.capacity;
+    const size_t chunk_idx = ( i - 1 ) / arch.capacity;
+    if ( chunk_idx >= arch.chunks.size() || row >= arch.chunks[ chunk_idx ]->size ) {
+      continue;
+    }
+
+    chunk& ch = *arch.chunks[ chunk_idx ];
+    if ( ch.data != data ) {
+      bases = std::make_tuple( column_base< Ts >( arch, ch )... );
+      data = ch.data;
+    }
+
+    f( ch.ids[ row ], std::get< Is >( bases )[ row ]... );
+  }
+}
+
+template < typename T >
+T* archetype_storage::column_base( archetype& arch, chunk& ch ) const {
+  return static_cast< T* >( arch.data( ch, arch.column_of[ component_type< T >::id ] - 1, 0 ) );
+}
+
+}
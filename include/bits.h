@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+namespace ecs {
+
+// bit scan helpers, argument must not be zero for ctz/clz
+inline size_t count_trailing_zeros( const uint64_t v ) noexcept {
+#if defined( _MSC_VER )
+  unsigned long result;
+  _BitScanForward64( &result, v );
+  return static_cast< size_t >( result );
+#else
+  return static_cast< size_t >( __builtin_ctzll( v ) );
+#endif
+}
+
+inline size_t count_leading_zeros( const uint64_t v ) noexcept {
+#if defined( _MSC_VER )
+  unsigned long result;
+  _BitScanReverse64( &result, v );
+  return static_cast< size_t >( 63 - result );
+#else
+  return static_cast< size_t >( __builtin_clzll( v ) );
+#endif
+}
+
+inline size_t popcount( const uint64_t v ) noexcept {
+#if defined( _MSC_VER )
+  return static_cast< size_t >( __popcnt64( v ) );
+#else
+  return static_cast< size_t >( __builtin_popcountll( v ) );
+#endif
+}
+
+// n lowest bits set, n <= 64
+inline uint64_t low_bits( const size_t n ) noexcept {
+  return n >= 64 ? ~uint64_t( 0 ) : ( uint64_t( 1 ) << n ) - 1;
+}
+
+// bits of word w, covering indices [ w * 64, w * 64 + 64 ), which fall into [ first, last )
+inline uint64_t word_range_bits( const size_t w, const size_t first, const size_t last ) noexcept {
+  const size_t base = w * 64;
+  if ( last <= base || first >= base + 64 ) {
+    return 0;
+  }
+
+  const size_t lo = first > base ? first - base : 0;
+  const size_t hi = last - base < 64 ? last - base : 64;
+  return low_bits( hi ) & ~low_bits( lo );
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace ecs {
+
+  // callbacks fired by components_storage for one component type, see
+  // components_storage::on_add; callbacks may add or remove components,
+  // but must not connect or disconnect callbacks of the signal being fired
+  class component_signal {
+  public:
+    using callback = std::function< void( const eid_t id ) >;
+
+    component_signal();
+
+    // returns a connection to disconnect with
+    size_t connect( callback f );
+    void disconnect( const size_t connection );
+
+    bool empty() const;
+    void emit( const eid_t id ) const;
+
+  private:
+    struct slot {
+      size_t   connection;
+      callback f;
+    };
+
+    std::vector< slot > m_slots;
+    size_t              m_next;
+  };
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "type_enumerator.h"
+
+#include <cstddef>
+
+namespace ecs {
+  struct component_storages {};
+  struct component_type_base {};
+
+  template < typename >
+  struct component_type: public component_type_base {
+    static const size_t id;
+  };
+
+  template < typename T >
+  const size_t component_type< T >::id = type_collection< component_storages >::type_id< T >();
+}
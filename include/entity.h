@@ -24,7 +24,7 @@ namespace ecs {
 
     /* components management */
     template < typename T, typename... Ts >
-    T& add( Ts&&... ts );
+    component_reference< T > add( Ts&&... ts );
 
     template < typename T >
     T* get();
@@ -33,7 +33,7 @@ namespace ecs {
     const T* get() const;
 
     template < typename T, typename... Ts >
-    T& set( Ts&&... ts );
+    component_reference< T > set( Ts&&... ts );
 
     template < typename T >
     void remove();
@@ -3,7 +3,7 @@
 namespace ecs {
 
 template < typename T, typename... Ts >
-T& entity::add( Ts&&... ts ) {
+component_reference< T > entity::add( Ts&&... ts ) {
   return m_owner->components().add_entity_component< T >( m_id, std::forward< Ts >( ts )... );
 }
 
@@ -18,7 +18,7 @@ const T* entity::get() const {
 }
 
 template < typename T, typename... Ts >
-T& entity::set( Ts&&... ts ) {
+component_reference< T > entity::set( Ts&&... ts ) {
   return m_owner->components().set_entity_component< T >( m_id, std::forward< Ts >( ts )... );
 }
 
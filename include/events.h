@@ -31,8 +31,10 @@ namespace ecs {
     void handle_all() override;
 
   private:
+    using event_vector = std::vector< E, resource_allocator< E > >;
+
     std::vector< system_event_handler_callback< E > > m_callbacks;
-    std::vector< E > m_events[ 2 ];
+    event_vector     m_events[ 2 ];  // drawn from the registry's resource
     size_t           m_current;
     registry&        m_registry;
   };
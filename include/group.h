@@ -0,0 +1,67 @@
+#pragma once
+
+#include "types.h"
+#include "query.h"
+#include "utility.h"
+
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+namespace ecs {
+  class components_storage;
+
+  template < typename T >
+  struct component_storage_type;
+
+  // entities having all of Ts, created through components_storage::group;
+  // the group owns storages of Ts and keeps members packed at the front
+  // of every page in the same order in all of them, so members are walked
+  // in lockstep without probing; owned components need unordered_page_policy
+  // and the same page size
+  template < typename... Ts >
+  class owning_group: public storage_observer {
+  public:
+    owning_group( components_storage& owner, typename component_storage_type< Ts >::type&... storages );
+
+    void on_added( const eid_t id ) override;
+    void on_removed( const eid_t id ) override;
+    void on_removed_range( const eid_t first, const eid_t last ) override;
+
+    bool contains( const eid_t id ) const;
+    size_t size() const;
+
+    // f( id, components... ) for every member, f may add or remove
+    // components of the entity it is called for
+    template < typename Ft >
+    void each( Ft&& f );
+
+    // reorder members within every page by compare( const T&, const T& )
+    // on the first owned component, the other storages follow, so each
+    // walks the page in key order
+    template < typename Compare >
+    void sort( Compare compare );
+
+  private:
+    template < typename Ft, size_t... Is >
+    void each( Ft& f, index_sequence< Is... > );
+
+    template < size_t... Is >
+    bool exist( const eid_t id, index_sequence< Is... > ) const;
+
+    template < size_t... Is >
+    void join( const eid_t id, index_sequence< Is... > );
+
+    template < size_t... Is >
+    void leave( const eid_t id, index_sequence< Is... > );
+
+    template < size_t... Is >
+    void reorder( const size_t page_idx, const std::vector< size_t >& order, index_sequence< Is... > );
+
+    components_storage&                                         m_owner;
+    std::tuple< typename component_storage_type< Ts >::type*... > m_storages;
+    size_t                                                      m_size;
+  };
+}
+
+// definitions are in group.hpp, included by storage.h
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+
+namespace ecs {
+
+//=============================================================================
+//
+// owning_group
+//
+//=============================================================================
+template < typename... Ts >
+owning_group< Ts... >::owning_group( components_storage& owner, typename component_storage_type< Ts >::type&... storages ):
+  m_owner( owner ),
+  m_storages( &storages... ),
+  m_size( 0 ) {
+  static_assert( sizeof...( Ts ) != 0, "group needs at least one component" );
+  static_assert( same_page_size< Ts... >::value, "grouped components must have the same page size" );
+}
+
+template < typename... Ts >
+void owning_group< Ts... >::on_added( const eid_t id ) {
+  if ( !contains( id ) && exist( id, make_index_sequence< sizeof...( Ts ) >() ) ) {
+    join( id, make_index_sequence< sizeof...( Ts ) >() );
+  }
+}
+
+template < typename... Ts >
+void owning_group< Ts... >::on_removed( const eid_t id ) {
+  if ( contains( id ) ) {
+    leave( id, make_index_sequence< sizeof...( Ts ) >() );
+  }
+}
+
+template < typename... Ts >
+void owning_group< Ts... >::on_removed_range( const eid_t first, const eid_t last ) {
+  const auto& storage = *std::get< 0 >( m_storages );
+  const size_t page_size = component_traits< typename std::tuple_element< 0, std::tuple< Ts... > >::type >::page_size;
+
+  using storage_type = typename std::remove_reference< decltype( storage ) >::type;
+  for ( size_t page_idx = storage.next_page( first / page_size ); page_idx != storage_type::bad_index && page_idx * page_size < last; page_idx = storage.next_page( page_idx + 1 ) ) {
+    // leaving swaps the last member into the place, so walk backwards
+    for ( size_t i = storage.page_group_size( page_idx ); i > 0; --i ) {
+      const size_t id = page_idx * page_size + storage.page_back_index( page_idx )[ i - 1 ];
+      if ( id >= first && id < last ) {
+        leave( static_cast< eid_t >( id ), make_index_sequence< sizeof...( Ts ) >() );
+      }
+    }
+  }
+}
+
+template < typename... Ts >
+bool owning_group< Ts... >::contains( const eid_t id ) const {
+  return std::get< 0 >( m_storages )->in_group( id );
+}
+
+template < typename... Ts >
+size_t owning_group< Ts... >::size() const {
+  return m_size;
+}
+
+template < typename... Ts >
+template < typename Ft >
+void owning_group< Ts... >::each( Ft&& f ) {
+  each( f, make_index_sequence< sizeof...( Ts ) >() );
+}
+
+template < typename... Ts >
+template < typename Ft, size_t... Is >
+void owning_group< Ts... >::each( Ft& f, index_sequence< Is... > ) {
+  const auto& storage = *std::get< 0 >( m_storages );
+  const size_t page_size = component_traits< typename std::tuple_element< 0, std::tuple< Ts... > >::type >::page_size;
+
+  using storage_type = typename std::remove_reference< decltype( storage ) >::type;
+  for ( size_t page_idx = storage.next_page( 0 ); page_idx != storage_type::bad_index; page_idx = storage.next_page( page_idx + 1 ) ) {
+    // walk backwards, a member moved into the place of a leaving one is
+    // either visited already or joined during the walk; pages are fetched
+    // again on every step since f could release them
+    for ( size_t i = storage.page_group_size( page_idx ); i > 0; --i ) {
+      if ( i > storage.page_group_size( page_idx ) ) {
+        continue;
+      }
+
+      const size_t id = page_idx * page_size + storage.page_back_index( page_idx )[ i - 1 ];
+      f( static_cast< eid_t >( id ), std::get< Is >( m_storages )->page_data( page_idx )[ i - 1 ]... );
+      m_owner.touch_written< Ft, Ts... >( static_cast< eid_t >( id ) );
+    }
+  }
+}
+
+template < typename... Ts >
+template < typename Compare >
+void owning_group< Ts... >::sort( Compare compare ) {
+  auto& storage = *std::get< 0 >( m_storages );
+
+  using storage_type = typename std::remove_reference< decltype( storage ) >::type;
+  std::vector< size_t > order;
+  for ( size_t page_idx = storage.next_page( 0 ); page_idx != storage_type::bad_index; page_idx = storage.next_page( page_idx + 1 ) ) {
+    order.resize( storage.page_group_size( page_idx ) );
+    if ( order.size() < 2 ) {
+      continue;
+    }
+
+    for ( size_t i = 0; i < order.size(); ++i ) {
+      order[ i ] = i;
+    }
+
+    const auto data = storage.page_data( page_idx );
+    std::stable_sort( order.begin(), order.end(), [ &compare, data ]( const size_t a, const size_t b ) {
+      return compare( data[ a ], data[ b ] );
+    } );
+
+    reorder( page_idx, order, make_index_sequence< sizeof...( Ts ) >() );
+  }
+}
+
+template < typename... Ts >
+template < size_t... Is >
+bool owning_group< Ts... >::exist( const eid_t id, index_sequence< Is... > ) const {
+  const bool exists[] = { std::get< Is >( m_storages )->exist( id )... };
+  return std::all_of( std::begin( exists ), std::end( exists ), []( const bool e ) { return e; } );
+}
+
+template < typename... Ts >
+template < size_t... Is >
+void owning_group< Ts... >::join( const eid_t id, index_sequence< Is... > ) {
+  using swallow = int[];
+  ( void )swallow{ 0, ( std::get< Is >( m_storages )->group_add( id ), 0 )... };
+
+  ++m_size;
+}
+
+template < typename... Ts >
+template < size_t... Is >
+void owning_group< Ts... >::leave( const eid_t id, index_sequence< Is... > ) {
+  using swallow = int[];
+  ( void )swallow{ 0, ( std::get< Is >( m_storages )->group_remove( id ), 0 )... };
+
+  --m_size;
+}
+
+template < typename... Ts >
+template < size_t... Is >
+void owning_group< Ts... >::reorder( const size_t page_idx, const std::vector< size_t >& order, index_sequence< Is... > ) {
+  // prefixes are in the same order, so one permutation fits all of them
+  using swallow = int[];
+  ( void )swallow{ 0, ( std::get< Is >( m_storages )->reorder_page( page_idx, 0, order.data(), order.size() ), 0 )... };
+}
+
+}
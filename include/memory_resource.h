@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+namespace ecs {
+
+// source of raw memory for containers, the C++11 counterpart of
+// std::pmr::memory_resource
+class memory_resource {
+public:
+  virtual ~memory_resource() = default;
+
+  void* allocate( const size_t bytes, const size_t alignment = alignof( std::max_align_t ) );
+  void deallocate( void* p, const size_t bytes, const size_t alignment = alignof( std::max_align_t ) );
+
+protected:
+  virtual void* do_allocate( const size_t bytes, const size_t alignment ) = 0;
+  virtual void do_deallocate( void* p, const size_t bytes, const size_t alignment ) = 0;
+};
+
+// global operator new and delete, over-aligned requests are served from
+// larger blocks
+memory_resource* new_delete_resource() noexcept;
+
+// arena handing out memory from chunks taken from upstream, deallocate does
+// nothing and everything is given back at once by release or destruction;
+// chunks grow geometrically starting from chunk_size, not thread safe
+class monotonic_resource: public memory_resource {
+public:
+  static const size_t default_chunk_size = 64 * 1024;
+
+  explicit monotonic_resource( memory_resource* upstream = new_delete_resource(), const size_t chunk_size = default_chunk_size );
+  ~monotonic_resource();
+
+  monotonic_resource( const monotonic_resource& ) = delete;
+  monotonic_resource& operator= ( const monotonic_resource& ) = delete;
+
+  void release();
+
+  memory_resource* upstream() const noexcept;
+
+protected:
+  void* do_allocate( const size_t bytes, const size_t alignment ) override;
+  void do_deallocate( void* p, const size_t bytes, const size_t alignment ) override;
+
+private:
+  struct chunk {
+    chunk* next;
+    size_t size;
+  };
+
+  memory_resource* m_upstream;
+  chunk*           m_chunks;
+  char*            m_current;
+  char*            m_end;
+  size_t           m_next_chunk_size;
+};
+
+// free lists of blocks by power of two size classes, blocks are carved from
+// chunks taken from upstream and recycled on deallocate; requests larger
+// than max_block_size or over-aligned go to upstream one by one; release
+// gives back all chunks and such blocks, not thread safe
+class pool_resource: public memory_resource {
+public:
+  static const size_t min_block_size = 16;
+  static const size_t max_block_size = size_t( 1 ) << 20;
+  static const size_t chunk_size = 64 * 1024;
+
+  explicit pool_resource( memory_resource* upstream = new_delete_resource() );
+  ~pool_resource();
+
+  pool_resource( const pool_resource& ) = delete;
+  pool_resource& operator= ( const pool_resource& ) = delete;
+
+  void release();
+
+  memory_resource* upstream() const noexcept;
+
+protected:
+  void* do_allocate( const size_t bytes, const size_t alignment ) override;
+  void do_deallocate( void* p, const size_t bytes, const size_t alignment ) override;
+
+private:
+  struct block {
+    block* next;
+  };
+
+  struct chunk {
+    chunk* next;
+    size_t size;
+  };
+
+  // header of a block taken from upstream one by one
+  struct large_block {
+    large_block* prev;
+    large_block* next;
+    size_t       size;
+    size_t       alignment;
+  };
+
+  static const size_t class_count = 17; // 16 bytes to 1 MB
+
+  // index of the smallest class holding bytes
+  static size_t size_class( const size_t bytes ) noexcept;
+
+  // header size keeping blocks after it aligned
+  static size_t large_header_size( const size_t alignment ) noexcept;
+
+  memory_resource*                    m_upstream;
+  std::array< block*, class_count >   m_free;
+  chunk*                              m_chunks;
+  large_block*                        m_large;
+};
+
+// standard allocator drawing from a memory_resource, new_delete_resource
+// by default
+template < typename T >
+class resource_allocator {
+public:
+  using value_type = T;
+
+  resource_allocator() noexcept;
+  resource_allocator( memory_resource* resource ) noexcept;
+
+  template < typename U >
+  resource_allocator( const resource_allocator< U >& other ) noexcept;
+
+  T* allocate( const size_t n );
+  void deallocate( T* p, const size_t n ) noexcept;
+
+  memory_resource* resource() const noexcept;
+
+private:
+  memory_resource* m_resource;
+};
+
+template < typename T, typename U >
+bool operator== ( const resource_allocator< T >& a, const resource_allocator< U >& b ) noexcept;
+
+template < typename T, typename U >
+bool operator!= ( const resource_allocator< T >& a, const resource_allocator< U >& b ) noexcept;
+
+// Alloc drawing from resource if it can be made from one, a default one otherwise
+template < typename Alloc >
+typename std::enable_if< std::is_constructible< Alloc, memory_resource* >::value, Alloc >::type make_allocator( memory_resource* resource );
+
+template < typename Alloc >
+typename std::enable_if< !std::is_constructible< Alloc, memory_resource* >::value, Alloc >::type make_allocator( memory_resource* resource );
+
+}
+
+#include "memory_resource.hpp"
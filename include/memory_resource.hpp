@@ -0,0 +1,61 @@
+#pragma once
+
+namespace ecs {
+
+//=============================================================================
+//
+// resource_allocator
+//
+//=============================================================================
+template < typename T >
+resource_allocator< T >::resource_allocator() noexcept:
+  m_resource( new_delete_resource() ) {
+}
+
+template < typename T >
+resource_allocator< T >::resource_allocator( memory_resource* resource ) noexcept:
+  m_resource( resource ) {
+}
+
+template < typename T >
+template < typename U >
+resource_allocator< T >::resource_allocator( const resource_allocator< U >& other ) noexcept:
+  m_resource( other.resource() ) {
+}
+
+template < typename T >
+T* resource_allocator< T >::allocate( const size_t n ) {
+  return static_cast< T* >( m_resource->allocate( n * sizeof( T ), alignof( T ) ) );
+}
+
+template < typename T >
+void resource_allocator< T >::deallocate( T* p, const size_t n ) noexcept {
+  m_resource->deallocate( p, n * sizeof( T ), alignof( T ) );
+}
+
+template < typename T >
+memory_resource* resource_allocator< T >::resource() const noexcept {
+  return m_resource;
+}
+
+template < typename T, typename U >
+bool operator== ( const resource_allocator< T >& a, const resource_allocator< U >& b ) noexcept {
+  return a.resource() == b.resource();
+}
+
+template < typename T, typename U >
+bool operator!= ( const resource_allocator< T >& a, const resource_allocator< U >& b ) noexcept {
+  return !( a == b );
+}
+
+template < typename Alloc >
+typename std::enable_if< std::is_constructible< Alloc, memory_resource* >::value, Alloc >::type make_allocator( memory_resource* resource ) {
+  return Alloc( resource );
+}
+
+template < typename Alloc >
+typename std::enable_if< !std::is_constructible< Alloc, memory_resource* >::value, Alloc >::type make_allocator( memory_resource* ) {
+  return Alloc();
+}
+
+}
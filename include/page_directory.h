@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace ecs {
+
+// page index to page pointer map of paged containers, a two-level radix
+// tree: the root holds a pointer per leaf_size pages and leaves are
+// allocated only while they hold a page, so memory follows the number of
+// live pages rather than the highest index; absent leaves point to a shared
+// empty one, so a lookup is two loads and a single bounds check
+template < typename P, typename Allocator = std::allocator< P* > >
+class page_directory {
+public:
+  static const size_t leaf_bits = 10;
+  static const size_t leaf_size = size_t( 1 ) << leaf_bits;
+  static const size_t npos;
+
+  explicit page_directory( const Allocator& alloc = Allocator() );
+  ~page_directory();
+
+  page_directory( const page_directory& ) = delete;
+  page_directory& operator= ( const page_directory& ) = delete;
+
+  // page at idx, nullptr if there is none
+  P* get( const size_t idx ) const noexcept;
+
+  // store a page at idx, p must not be nullptr
+  void set( const size_t idx, P* p );
+
+  // forget the page at idx and return it, nullptr if there was none
+  P* release( const size_t idx );
+
+  // drop all leaves, pages are owned by the caller
+  void clear();
+
+  // one past the highest index a page was ever set at since the last clear
+  size_t size() const noexcept;
+
+  // first index not less than idx and last index not greater than idx
+  // holding a page, npos if there is none; empty leaves are skipped at once
+  size_t next( const size_t idx ) const noexcept;
+  size_t prev( const size_t idx ) const noexcept;
+
+  // f( idx, page ) for every page in ascending order of indices,
+  // f may release the page it is called for
+  template < typename Ft >
+  void for_each( Ft&& f ) const;
+
+  size_t leaf_count() const noexcept;
+
+private:
+  static const size_t leaf_mask = leaf_size - 1;
+  static const size_t leaf_words = leaf_size / 64;
+
+  struct leaf {
+    std::array< P*, leaf_size >         pages;
+    std::array< uint64_t, leaf_words >  mask;  // bit per non-null page
+    size_t                              count;
+  };
+
+  using leaf_allocator = typename std::allocator_traits< Allocator >::template rebind_alloc< leaf >;
+  using leaf_allocator_traits = std::allocator_traits< leaf_allocator >;
+  using leaf_table = std::vector< leaf*, typename std::allocator_traits< Allocator >::template rebind_alloc< leaf* > >;
+
+  static leaf s_empty_leaf;
+
+  leaf_allocator m_allocator;
+  leaf_table     m_leaves;
+  size_t         m_size;
+  size_t         m_leaf_count;
+};
+
+template < typename P, typename Allocator >
+const size_t page_directory< P, Allocator >::npos = std::numeric_limits< size_t >::max();
+
+template < typename P, typename Allocator >
+typename page_directory< P, Allocator >::leaf page_directory< P, Allocator >::s_empty_leaf;
+
+}
+
+#include "page_directory.hpp"
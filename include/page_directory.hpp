@@ -0,0 +1,161 @@
+#pragma once
+
+#include "bits.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ecs {
+
+//=============================================================================
+//
+// page_directory
+//
+//=============================================================================
+template < typename P, typename Allocator >
+page_directory< P, Allocator >::page_directory( const Allocator& alloc ):
+  m_allocator( alloc ),
+  m_leaves( alloc ),
+  m_size( 0 ),
+  m_leaf_count( 0 ) {
+}
+
+template < typename P, typename Allocator >
+page_directory< P, Allocator >::~page_directory() {
+  clear();
+}
+
+template < typename P, typename Allocator >
+inline P* page_directory< P, Allocator >::get( const size_t idx ) const noexcept {
+  const size_t hi = idx >> leaf_bits;
+  return hi < m_leaves.size() ? m_leaves[ hi ]->pages[ idx & leaf_mask ] : nullptr;
+}
+
+template < typename P, typename Allocator >
+void page_directory< P, Allocator >::set( const size_t idx, P* p ) {
+  assert( p );
+
+  const size_t hi = idx >> leaf_bits;
+  if ( m_leaves.size() <= hi ) {
+    m_leaves.resize( hi + 1, &s_empty_leaf );
+  }
+
+  if ( m_leaves[ hi ] == &s_empty_leaf ) {
+    leaf* lf = leaf_allocator_traits::allocate( m_allocator, 1 );
+    leaf_allocator_traits::construct( m_allocator, lf );
+    m_leaves[ hi ] = lf;
+    ++m_leaf_count;
+  }
+
+  leaf& lf = *m_leaves[ hi ];
+  const size_t lo = idx & leaf_mask;
+  const uint64_t bit = uint64_t( 1 ) << ( lo % 64 );
+  if ( !( lf.mask[ lo / 64 ] & bit ) ) {
+    lf.mask[ lo / 64 ] |= bit;
+    ++lf.count;
+  }
+
+  lf.pages[ lo ] = p;
+  m_size = std::max( m_size, idx + 1 );
+}
+
+template < typename P, typename Allocator >
+P* page_directory< P, Allocator >::release( const size_t idx ) {
+  const size_t hi = idx >> leaf_bits;
+  const size_t lo = idx & leaf_mask;
+  if ( hi >= m_leaves.size() || !m_leaves[ hi ]->pages[ lo ] ) {
+    return nullptr;
+  }
+
+  leaf* lf = m_leaves[ hi ];
+  P* result = lf->pages[ lo ];
+  lf->pages[ lo ] = nullptr;
+  lf->mask[ lo / 64 ] &= ~( uint64_t( 1 ) << ( lo % 64 ) );
+
+  if ( --lf->count == 0 ) {
+    leaf_allocator_traits::destroy( m_allocator, lf );
+    leaf_allocator_traits::deallocate( m_allocator, lf, 1 );
+    m_leaves[ hi ] = &s_empty_leaf;
+    --m_leaf_count;
+  }
+
+  return result;
+}
+
+template < typename P, typename Allocator >
+void page_directory< P, Allocator >::clear() {
+  for ( auto& lf : m_leaves ) {
+    if ( lf != &s_empty_leaf ) {
+      leaf_allocator_traits::destroy( m_allocator, lf );
+      leaf_allocator_traits::deallocate( m_allocator, lf, 1 );
+    }
+  }
+
+  leaf_table( m_leaves.get_allocator() ).swap( m_leaves );
+  m_size = 0;
+  m_leaf_count = 0;
+}
+
+template < typename P, typename Allocator >
+size_t page_directory< P, Allocator >::size() const noexcept {
+  return m_size;
+}
+
+template < typename P, typename Allocator >
+size_t page_directory< P, Allocator >::next( const size_t idx ) const noexcept {
+  for ( size_t hi = idx >> leaf_bits; hi < m_leaves.size(); ++hi ) {
+    const leaf& lf = *m_leaves[ hi ];
+    if ( lf.count == 0 ) {
+      continue;
+    }
+
+    const size_t from = hi == idx >> leaf_bits ? idx & leaf_mask : 0;
+    for ( size_t w = from / 64; w < leaf_words; ++w ) {
+      const uint64_t bits = w == from / 64 ? lf.mask[ w ] & ~low_bits( from % 64 ) : lf.mask[ w ];
+      if ( bits ) {
+        return ( hi << leaf_bits ) + w * 64 + count_trailing_zeros( bits );
+      }
+    }
+  }
+
+  return npos;
+}
+
+template < typename P, typename Allocator >
+size_t page_directory< P, Allocator >::prev( const size_t idx ) const noexcept {
+  if ( m_leaves.empty() ) {
+    return npos;
+  }
+
+  for ( size_t hi = std::min( idx >> leaf_bits, m_leaves.size() - 1 ) + 1; hi > 0; --hi ) {
+    const leaf& lf = *m_leaves[ hi - 1 ];
+    if ( lf.count == 0 ) {
+      continue;
+    }
+
+    const size_t to = hi - 1 == idx >> leaf_bits ? idx & leaf_mask : leaf_mask;
+    for ( size_t w = to / 64 + 1; w > 0; --w ) {
+      const uint64_t bits = w - 1 == to / 64 ? lf.mask[ w - 1 ] & low_bits( to % 64 + 1 ) : lf.mask[ w - 1 ];
+      if ( bits ) {
+        return ( ( hi - 1 ) << leaf_bits ) + ( w - 1 ) * 64 + 63 - count_leading_zeros( bits );
+      }
+    }
+  }
+
+  return npos;
+}
+
+template < typename P, typename Allocator >
+template < typename Ft >
+void page_directory< P, Allocator >::for_each( Ft&& f ) const {
+  for ( size_t idx = next( 0 ); idx != npos; idx = next( idx + 1 ) ) {
+    f( idx, get( idx ) );
+  }
+}
+
+template < typename P, typename Allocator >
+size_t page_directory< P, Allocator >::leaf_count() const noexcept {
+  return m_leaf_count;
+}
+
+}
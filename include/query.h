@@ -0,0 +1,71 @@
+#pragma once
+
+#include "types.h"
+#include "memory_resource.h"
+#include "sparse_vector.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace ecs {
+  class components_storage;
+
+  struct storage_observers {};
+
+  // gets notified by components_storage about changes of observed component types
+  class storage_observer {
+  public:
+    virtual ~storage_observer() = default;
+
+    // id got a component of one of the observed types
+    virtual void on_added( const eid_t id ) = 0;
+
+    // id is about to lose a component of one of the observed types
+    virtual void on_removed( const eid_t id ) = 0;
+    virtual void on_removed_range( const eid_t first, const eid_t last ) = 0;
+  };
+
+  // dense set of entity ids kept up to date by components_storage, the ids
+  // and the id to position map draw from resource
+  class query_base: public storage_observer {
+  public:
+    using id_vector = std::vector< eid_t, resource_allocator< eid_t > >;
+
+    explicit query_base( memory_resource* resource );
+
+    void on_removed( const eid_t id ) override;
+    void on_removed_range( const eid_t first, const eid_t last ) override;
+
+    bool contains( const eid_t id ) const;
+    size_t size() const;
+
+    // matching ids in no particular order
+    const id_vector& ids() const;
+
+  protected:
+    void insert( const eid_t id );
+
+    id_vector                                                                       m_ids;
+    sparse_vector< size_t, 64, ordered_page_policy, resource_allocator< size_t > > m_positions; // id -> position in m_ids
+  };
+
+  // entities having all of Ts, created through components_storage::query;
+  // iteration costs O( matches ) since non-matching ids are never visited
+  template < typename... Ts >
+  class cached_query: public query_base {
+  public:
+    explicit cached_query( components_storage& storage );
+
+    void on_added( const eid_t id ) override;
+
+    // f( id, components... ) for every matching entity, f may add or
+    // remove components of the entity it is called for
+    template < typename Ft >
+    void each( Ft&& f );
+
+  private:
+    components_storage& m_storage;
+  };
+}
+
+// definitions are in query.hpp, included by storage.h
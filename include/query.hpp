@@ -0,0 +1,39 @@
+#pragma once
+
+namespace ecs {
+
+//=============================================================================
+//
+// cached_query
+//
+//=============================================================================
+template < typename... Ts >
+cached_query< Ts... >::cached_query( components_storage& storage ):
+  query_base( storage.resource() ),
+  m_storage( storage ) {
+}
+
+template < typename... Ts >
+void cached_query< Ts... >::on_added( const eid_t id ) {
+  if ( !contains( id ) && m_storage.has_components< Ts... >( id ) ) {
+    insert( id );
+  }
+}
+
+template < typename... Ts >
+template < typename Ft >
+void cached_query< Ts... >::each( Ft&& f ) {
+  // walk backwards, an id moved into the place of a removed one is
+  // either visited already or added during the walk
+  for ( size_t i = m_ids.size(); i > 0; --i ) {
+    if ( i > m_ids.size() ) {
+      continue;
+    }
+
+    const eid_t id = m_ids[ i - 1 ];
+    f( id, *m_storage.find_component< Ts >( id )... );
+    m_storage.touch_written< Ft, Ts... >( id );
+  }
+}
+
+}
@@ -4,6 +4,7 @@
 
 #include <list>
 #include <set>
+#include <string>
 #include <memory>
 
 namespace ecs {
@@ -27,7 +28,9 @@ namespace ecs {
     friend class system_configure;
 
   public:
-    registry();
+    // components, free entity ids and queued events draw memory from
+    // resource, which must outlive the registry
+    explicit registry( const storage_backend backend = storage_backend::sparse, memory_resource* resource = new_delete_resource() );
 
     registry( const registry& ) = delete;
     registry( registry&& ) = delete;
@@ -41,6 +44,22 @@ namespace ecs {
 
     components_storage& components();
 
+    memory_resource* resource() const;
+
+    /* snapshots */
+    // entity id allocation state and components of Ts written to path,
+    // see components_storage::save
+    template < typename... Ts >
+    void save_snapshot( const std::string& path ) const;
+
+    // restore a snapshot written by save_snapshot< Ts... >, components of
+    // other types are left as they are; throws std::runtime_error if the
+    // free ids repeat or are not below the id counter, and if components
+    // of Ts are loaded for free or unallocated ids, in which case the
+    // components of Ts are removed
+    template < typename... Ts >
+    void load_snapshot( const std::string& path );
+
     /* systems management */
     template < typename S, typename... Args >
     system_configure< system_wrapper< S > > add_system( Args&& ...args );
@@ -73,10 +92,14 @@ namespace ecs {
     template < typename E >
     event_handler< E >& get_or_create_handler();
 
+    // loaded components of Ts belong to ids below counter which are not free
+    template < typename... Ts >
+    bool snapshot_components_consistent( const eid_t counter, const std::vector< eid_t >& freeIds );
+
     /* entities */
-    std::list< eid_t > m_freeEntityIds;
-    components_storage m_components;
-    eid_t              m_entityIdCounter;
+    std::list< eid_t, resource_allocator< eid_t > > m_freeEntityIds;
+    components_storage                              m_components;
+    eid_t                                           m_entityIdCounter;
 
     /* systems */
     std::vector< std::shared_ptr< system_base > > m_systems;
@@ -3,8 +3,13 @@
 #include "system.h"
 #include "events.h"
 
+#include <algorithm>
+#include <cstring>
 #include <exception>
+#include <limits>
 #include <memory>
+#include <stdexcept>
+#include <vector>
 
 namespace ecs {
 
@@ -22,6 +27,71 @@ system_configure< system_wrapper< S > > registry::add_system( Args&& ...args ) {
   return system_configure< system_wrapper< S > >( static_cast< system_wrapper< S >& >( *m_systems[ sid ] ), *this );
 }
 
+template < typename... Ts >
+void registry::save_snapshot( const std::string& path ) const {
+  snapshot_writer out( path );
+
+  const std::vector< eid_t > freeIds( m_freeEntityIds.begin(), m_freeEntityIds.end() );
+  out.write_value( uint64_t( sizeof( eid_t ) ) );
+  out.write_value( m_entityIdCounter );
+  out.write_value( uint64_t( freeIds.size() ) );
+  out.write( freeIds.data(), freeIds.size() * sizeof( eid_t ) );
+
+  m_components.save< Ts... >( out );
+  out.close();
+}
+
+template < typename... Ts >
+void registry::load_snapshot( const std::string& path ) {
+  snapshot_reader in( path );
+
+  if ( in.read_value< uint64_t >() != sizeof( eid_t ) ) {
+    throw std::runtime_error( "Snapshot entity id size mismatch" );
+  }
+
+  const auto counter = in.read_value< eid_t >();
+  const auto count = in.read_value< uint64_t >();
+  if ( count > in.remaining() / sizeof( eid_t ) ) {
+    throw std::runtime_error( "Unexpected end of snapshot file" );
+  }
+
+  std::vector< eid_t > freeIds( static_cast< size_t >( count ) );
+  if ( !freeIds.empty() ) {
+    std::memcpy( freeIds.data(), in.read( freeIds.size() * sizeof( eid_t ) ), freeIds.size() * sizeof( eid_t ) );
+  }
+
+  // every id below counter is either live or free, and free just once
+  std::vector< eid_t > sorted( freeIds );
+  std::sort( sorted.begin(), sorted.end() );
+  if ( ( !sorted.empty() && sorted.back() >= counter ) || std::adjacent_find( sorted.begin(), sorted.end() ) != sorted.end() ) {
+    throw std::runtime_error( "Corrupted snapshot entity ids" );
+  }
+
+  m_components.load< Ts... >( in );
+
+  if ( !snapshot_components_consistent< Ts... >( counter, freeIds ) ) {
+    using swallow = int[];
+    ( void )swallow{ 0, ( m_components.remove_entity_component_range< Ts >( 0, std::numeric_limits< eid_t >::max() ), 0 )... };
+    throw std::runtime_error( "Snapshot components belong to free entity ids" );
+  }
+
+  m_entityIdCounter = counter;
+  m_freeEntityIds.assign( freeIds.begin(), freeIds.end() );
+}
+
+template < typename... Ts >
+bool registry::snapshot_components_consistent( const eid_t counter, const std::vector< eid_t >& freeIds ) {
+  bool result( true );
+  using swallow = int[];
+  ( void )swallow{ 0, ( result = result && ( m_components.storage< Ts >().size() == 0 || m_components.storage< Ts >().index_range().second < counter ), 0 )... };
+
+  for ( size_t i = 0; i < freeIds.size() && result; ++i ) {
+    ( void )swallow{ 0, ( result = result && !m_components.storage< Ts >().exist( freeIds[ i ] ), 0 )... };
+  }
+
+  return result;
+}
+
 template < typename S >
 system_wrapper< S >& registry::get_system() {
   const auto sid = type_collection< systems >::type_id< S >();
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ecs {
+
+// binary snapshot files: a header of magic and format version followed by
+// sections written by components_storage::save and registry::save_snapshot;
+// data is kept in native byte order, files of another byte order are
+// rejected by the magic check
+
+// buffered writer of a snapshot file, throws std::runtime_error on I/O errors
+class snapshot_writer {
+public:
+  static const uint32_t magic = 0x53534345; // "ECSS"
+  static const uint32_t version = 2;
+
+  explicit snapshot_writer( const std::string& path );
+  ~snapshot_writer();
+
+  snapshot_writer( const snapshot_writer& ) = delete;
+  snapshot_writer& operator= ( const snapshot_writer& ) = delete;
+
+  void write( const void* data, const size_t bytes );
+
+  template < typename T >
+  void write_value( const T& value );
+
+  // flush and close the file, called by the destructor as well, which
+  // swallows errors
+  void close();
+
+private:
+  std::FILE* m_file;
+};
+
+// reader of a snapshot file, the file is mapped into memory where mmap is
+// available and read at once otherwise, so sections are consumed straight
+// from the file image; throws std::runtime_error on I/O errors, on a bad
+// header and on reads past the end
+class snapshot_reader {
+public:
+  explicit snapshot_reader( const std::string& path );
+  ~snapshot_reader();
+
+  snapshot_reader( const snapshot_reader& ) = delete;
+  snapshot_reader& operator= ( const snapshot_reader& ) = delete;
+
+  // pointer to the next bytes of the file, not aligned in general
+  const void* read( const size_t bytes );
+
+  template < typename T >
+  T read_value();
+
+  size_t remaining() const;
+
+  // true if the file is mapped rather than read into a buffer
+  bool mapped() const;
+
+private:
+  void unmap();
+
+  const char*         m_data;
+  size_t              m_size;
+  size_t              m_pos;
+  bool                m_mapped;
+  std::vector< char > m_buffer;
+};
+
+}
+
+#include "snapshot.hpp"
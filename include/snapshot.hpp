@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+
+namespace ecs {
+
+//=============================================================================
+//
+// snapshot_writer
+//
+//=============================================================================
+template < typename T >
+void snapshot_writer::write_value( const T& value ) {
+  static_assert( std::is_trivially_copyable< T >::value, "only trivially copyable values can be written" );
+
+  write( &value, sizeof( T ) );
+}
+
+//=============================================================================
+//
+// snapshot_reader
+//
+//=============================================================================
+template < typename T >
+T snapshot_reader::read_value() {
+  static_assert( std::is_trivially_copyable< T >::value, "only trivially copyable values can be read" );
+
+  T result;
+  std::memcpy( static_cast< void* >( &result ), read( sizeof( T ) ), sizeof( T ) );
+  return result;
+}
+
+}
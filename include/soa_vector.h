@@ -0,0 +1,193 @@
+#pragma once
+
+#include "page_directory.h"
+#include "sparse_vector.h"
+#include "utility.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace ecs {
+
+// a single field of a component stored as a separate array:
+//   soa_field< Position, float, &Position::x >
+template < typename C, typename F, F C::* Member >
+struct soa_field {
+  using type = F;
+
+  static_assert( std::is_trivially_copyable< F >::value, "SoA fields must be trivially copyable" );
+
+  static F& get( C& c ) noexcept;
+  static const F& get( const C& c ) noexcept;
+};
+
+// list of fields a component is split into, declared through
+// component_traits< C >::fields
+template < typename... Fs >
+struct soa_fields {
+  static const size_t count = sizeof...( Fs );
+
+  template < size_t PageSize >
+  using arrays = std::tuple< std::array< typename Fs::type, PageSize >... >;
+
+  using pointers = std::tuple< typename Fs::type*... >;
+  using const_pointers = std::tuple< const typename Fs::type*... >;
+
+  template < size_t I >
+  using field_type = typename std::tuple_element< I, std::tuple< typename Fs::type... > >::type;
+
+  template < typename C, typename Arrays >
+  static void scatter( const C& value, Arrays& arrays, const size_t slot );
+
+  template < typename C, typename Arrays >
+  static void gather( C& value, const Arrays& arrays, const size_t slot );
+
+  template < typename Arrays >
+  static pointers data( Arrays& arrays );
+
+  template < typename Arrays >
+  static const_pointers data( const Arrays& arrays );
+
+private:
+  template < typename C, typename Arrays, size_t... Is >
+  static void scatter( const C& value, Arrays& arrays, const size_t slot, index_sequence< Is... > );
+
+  template < typename C, typename Arrays, size_t... Is >
+  static void gather( C& value, const Arrays& arrays, const size_t slot, index_sequence< Is... > );
+
+  template < typename Arrays, size_t... Is >
+  static pointers data( Arrays& arrays, index_sequence< Is... > );
+
+  template < typename Arrays, size_t... Is >
+  static const_pointers data( const Arrays& arrays, index_sequence< Is... > );
+};
+
+// structure-of-arrays counterpart of sparse_vector, every page keeps
+// one array per field indexed by slot, so pages of different soa_vectors
+// line up and can be processed in lockstep
+template < typename T, size_t PageSize, typename Fields, typename Allocator = std::allocator< T > >
+class soa_vector: public sparse_vector_base {
+public:
+  using fields = Fields;
+  using pointers = typename Fields::pointers;
+  using const_pointers = typename Fields::const_pointers;
+  using allocator_type = Allocator;
+  using reference = void;
+
+  static const size_t bad_index;
+  static const size_t mask_words = ( PageSize + 63 ) / 64;
+
+  explicit soa_vector( const Allocator& alloc = Allocator() );
+  ~soa_vector();
+
+  soa_vector( const soa_vector& ) = delete;
+  soa_vector& operator= ( const soa_vector& ) = delete;
+
+  // modify
+  void clear();
+
+  void insert( const size_t pos, const T& arg );
+
+  template < typename... Args >
+  void emplace( const size_t pos, Args&&... args );
+
+  // insert or overwrite
+  void set( const size_t pos, const T& arg );
+
+  void erase( const size_t pos ) override;
+
+  // same as sparse_vector ones
+  template < typename... Args >
+  void emplace_range( const size_t first, const size_t count, const Args&... args );
+
+  template < typename IdIt, typename ValueIt >
+  void insert_range( IdIt first, const IdIt last, ValueIt value );
+
+  void erase_range( const size_t first, const size_t last );
+
+  // access
+  bool exist( const size_t pos ) const noexcept;
+
+  size_t size() const;
+
+  // gathers fields into a new T, element must exist
+  T get( const size_t pos ) const;
+
+  template < size_t I >
+  typename Fields::template field_type< I >& field( const size_t pos ) noexcept;
+
+  template < size_t I >
+  const typename Fields::template field_type< I >& field( const size_t pos ) const noexcept;
+
+  std::pair< size_t, size_t > index_range() const;
+
+  // iterate over indices of existing elements in ascending order,
+  // f is allowed to modify the vector
+  template < typename Ft >
+  void for_each_index( Ft&& f ) const;
+
+  // same for indices within [ first, last )
+  template < typename Ft >
+  void for_each_index( const size_t first, const size_t last, Ft&& f ) const;
+
+  // f( base_pos, mask, fields ) for every non-empty page, fields is a tuple
+  // of PageSize long arrays, std::get< I >( fields )[ i ] is the I-th field
+  // of the element at base_pos + i, which exists if bit i of mask is set;
+  // slots without an element hold stale but valid values
+  template < typename Ft >
+  void for_each_page( Ft&& f );
+
+  template < typename Ft >
+  void for_each_page( Ft&& f ) const;
+
+  // page level change tracking, see sparse_vector::touch
+  void touch( const size_t pos, const uint64_t version );
+  uint64_t page_version( const size_t page_idx ) const;
+
+  // page level access, nullptr if the page does not exist
+  size_t page_count() const;
+
+  // first existing page not less than page_idx, bad_index if there is none
+  size_t next_page( const size_t page_idx ) const;
+
+  const uint64_t* page_mask( const size_t page_idx ) const;
+  pointers page_data( const size_t page_idx );
+  const_pointers page_data( const size_t page_idx ) const;
+
+private:
+  struct page {
+    page();
+
+    std::array< uint64_t, mask_words >                 mask;
+    typename Fields::template arrays< PageSize >       data;
+    size_t                                             size;
+    uint64_t                                           version;
+  };
+
+  using page_allocator = typename std::allocator_traits< Allocator >::template rebind_alloc< page >;
+  using page_allocator_traits = std::allocator_traits< page_allocator >;
+  using page_table = page_directory< page, typename std::allocator_traits< Allocator >::template rebind_alloc< page* > >;
+
+  page& get_or_create_page( const size_t page_idx );
+  page* get_page( const size_t page_idx ) const;
+  void erase_page( const size_t page_idx );
+
+  // mark slot as occupied, returns false if it already was
+  bool occupy( page& pg, const size_t slot );
+
+  page_allocator m_allocator;
+  page_table     m_pages;
+};
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+const size_t soa_vector< T, PageSize, Fields, Allocator >::bad_index = std::numeric_limits< size_t >::max();
+
+}
+
+#include "soa_vector.hpp"
@@ -0,0 +1,421 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+
+namespace ecs {
+
+//=============================================================================
+//
+// soa_field / soa_fields
+//
+//=============================================================================
+template < typename C, typename F, F C::* Member >
+F& soa_field< C, F, Member >::get( C& c ) noexcept {
+  return c.*Member;
+}
+
+template < typename C, typename F, F C::* Member >
+const F& soa_field< C, F, Member >::get( const C& c ) noexcept {
+  return c.*Member;
+}
+
+template < typename... Fs >
+template < typename C, typename Arrays >
+void soa_fields< Fs... >::scatter( const C& value, Arrays& arrays, const size_t slot ) {
+  scatter( value, arrays, slot, make_index_sequence< count >() );
+}
+
+template < typename... Fs >
+template < typename C, typename Arrays >
+void soa_fields< Fs... >::gather( C& value, const Arrays& arrays, const size_t slot ) {
+  gather( value, arrays, slot, make_index_sequence< count >() );
+}
+
+template < typename... Fs >
+template < typename Arrays >
+typename soa_fields< Fs... >::pointers soa_fields< Fs... >::data( Arrays& arrays ) {
+  return data( arrays, make_index_sequence< count >() );
+}
+
+template < typename... Fs >
+template < typename Arrays >
+typename soa_fields< Fs... >::const_pointers soa_fields< Fs... >::data( const Arrays& arrays ) {
+  return data( arrays, make_index_sequence< count >() );
+}
+
+template < typename... Fs >
+template < typename C, typename Arrays, size_t... Is >
+void soa_fields< Fs... >::scatter( const C& value, Arrays& arrays, const size_t slot, index_sequence< Is... > ) {
+  using swallow = int[];
+  ( void )swallow{ 0, ( std::get< Is >( arrays )[ slot ] = Fs::get( value ), 0 )... };
+}
+
+template < typename... Fs >
+template < typename C, typename Arrays, size_t... Is >
+void soa_fields< Fs... >::gather( C& value, const Arrays& arrays, const size_t slot, index_sequence< Is... > ) {
+  using swallow = int[];
+  ( void )swallow{ 0, ( Fs::get( value ) = std::get< Is >( arrays )[ slot ], 0 )... };
+}
+
+template < typename... Fs >
+template < typename Arrays, size_t... Is >
+typename soa_fields< Fs... >::pointers soa_fields< Fs... >::data( Arrays& arrays, index_sequence< Is... > ) {
+  return pointers( std::get< Is >( arrays ).data()... );
+}
+
+template < typename... Fs >
+template < typename Arrays, size_t... Is >
+typename soa_fields< Fs... >::const_pointers soa_fields< Fs... >::data( const Arrays& arrays, index_sequence< Is... > ) {
+  return const_pointers( std::get< Is >( arrays ).data()... );
+}
+
+//=============================================================================
+//
+// soa_vector
+//
+//=============================================================================
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+soa_vector< T, PageSize, Fields, Allocator >::soa_vector( const Allocator& alloc ):
+  m_allocator( alloc ),
+  m_pages( alloc ) {
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+soa_vector< T, PageSize, Fields, Allocator >::~soa_vector() {
+  clear();
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+inline typename soa_vector< T, PageSize, Fields, Allocator >::page& soa_vector< T, PageSize, Fields, Allocator >::get_or_create_page( const size_t page_idx ) {
+  page* pg = m_pages.get( page_idx );
+  if ( !pg ) {
+    pg = page_allocator_traits::allocate( m_allocator, 1 );
+    page_allocator_traits::construct( m_allocator, pg );
+    try {
+      m_pages.set( page_idx, pg );
+    } catch ( ... ) {
+      page_allocator_traits::destroy( m_allocator, pg );
+      page_allocator_traits::deallocate( m_allocator, pg, 1 );
+      throw;
+    }
+  }
+
+  return *pg;
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+inline typename soa_vector< T, PageSize, Fields, Allocator >::page* soa_vector< T, PageSize, Fields, Allocator >::get_page( const size_t page_idx ) const {
+  return m_pages.get( page_idx );
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+void soa_vector< T, PageSize, Fields, Allocator >::erase_page( const size_t page_idx ) {
+  if ( page* pg = m_pages.release( page_idx ) ) {
+    page_allocator_traits::destroy( m_allocator, pg );
+    page_allocator_traits::deallocate( m_allocator, pg, 1 );
+  }
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+inline bool soa_vector< T, PageSize, Fields, Allocator >::occupy( page& pg, const size_t slot ) {
+  const uint64_t bit = uint64_t( 1 ) << ( slot % 64 );
+  if ( pg.mask[ slot / 64 ] & bit ) {
+    return false;
+  }
+
+  pg.mask[ slot / 64 ] |= bit;
+  ++pg.size;
+
+  return true;
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+void soa_vector< T, PageSize, Fields, Allocator >::clear() {
+  m_pages.for_each( [ this ]( const size_t page_idx, page* ) {
+    erase_page( page_idx );
+  } );
+
+  m_pages.clear();
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+void soa_vector< T, PageSize, Fields, Allocator >::insert( const size_t pos, const T& arg ) {
+  assert( pos < bad_index );
+
+  auto& pg = get_or_create_page( pos / PageSize );
+  if ( occupy( pg, pos % PageSize ) ) {
+    Fields::scatter( arg, pg.data, pos % PageSize );
+  }
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < typename... Args >
+void soa_vector< T, PageSize, Fields, Allocator >::emplace( const size_t pos, Args&&... args ) {
+  assert( pos < bad_index );
+
+  auto& pg = get_or_create_page( pos / PageSize );
+  if ( occupy( pg, pos % PageSize ) ) {
+    Fields::scatter( T( std::forward< Args >( args )... ), pg.data, pos % PageSize );
+  }
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+void soa_vector< T, PageSize, Fields, Allocator >::set( const size_t pos, const T& arg ) {
+  assert( pos < bad_index );
+
+  auto& pg = get_or_create_page( pos / PageSize );
+  occupy( pg, pos % PageSize );
+  Fields::scatter( arg, pg.data, pos % PageSize );
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < typename... Args >
+void soa_vector< T, PageSize, Fields, Allocator >::emplace_range( const size_t first, const size_t count, const Args&... args ) {
+  assert( count < bad_index - first );
+
+  // fields are trivially copyable, so one value is scattered everywhere
+  const T value( args... );
+  for ( size_t pos = first; pos < first + count; ++pos ) {
+    auto& pg = get_or_create_page( pos / PageSize );
+    if ( occupy( pg, pos % PageSize ) ) {
+      Fields::scatter( value, pg.data, pos % PageSize );
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < typename IdIt, typename ValueIt >
+void soa_vector< T, PageSize, Fields, Allocator >::insert_range( IdIt first, const IdIt last, ValueIt value ) {
+  for ( ; first != last; ++first, ++value ) {
+    insert( *first, *value );
+  }
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+void soa_vector< T, PageSize, Fields, Allocator >::erase_range( const size_t first, const size_t last ) {
+  for ( size_t page_idx = m_pages.next( first / PageSize ); first < last && page_idx < m_pages.size() && page_idx * PageSize < last; page_idx = m_pages.next( page_idx + 1 ) ) {
+    const size_t base = page_idx * PageSize;
+    if ( first <= base && last - base >= PageSize ) {
+      erase_page( page_idx );
+      continue;
+    }
+
+    for ( size_t pos = std::max( first, base ); pos < std::min( last, base + PageSize ); ++pos ) {
+      erase( pos );
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+void soa_vector< T, PageSize, Fields, Allocator >::erase( const size_t pos ) {
+  assert( pos < bad_index );
+
+  const size_t page_idx = pos / PageSize;
+  const size_t slot = pos % PageSize;
+  auto pg = get_page( page_idx );
+  if ( !pg ) {
+    return;
+  }
+
+  const uint64_t bit = uint64_t( 1 ) << ( slot % 64 );
+  if ( pg->mask[ slot / 64 ] & bit ) {
+    pg->mask[ slot / 64 ] &= ~bit;
+    if ( --pg->size == 0 ) {
+      erase_page( page_idx );
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+bool soa_vector< T, PageSize, Fields, Allocator >::exist( const size_t pos ) const noexcept {
+  assert( pos < bad_index );
+
+  const auto pg = get_page( pos / PageSize );
+  if ( !pg ) {
+    return false;
+  }
+
+  const size_t slot = pos % PageSize;
+  return ( pg->mask[ slot / 64 ] >> ( slot % 64 ) ) & 1;
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+size_t soa_vector< T, PageSize, Fields, Allocator >::size() const {
+  size_t result( 0 );
+  m_pages.for_each( [ &result ]( const size_t, const page* pg ) {
+    result += pg->size;
+  } );
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+T soa_vector< T, PageSize, Fields, Allocator >::get( const size_t pos ) const {
+  assert( exist( pos ) );
+
+  T result;
+  Fields::gather( result, m_pages.get( pos / PageSize )->data, pos % PageSize );
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < size_t I >
+typename Fields::template field_type< I >& soa_vector< T, PageSize, Fields, Allocator >::field( const size_t pos ) noexcept {
+  assert( exist( pos ) );
+  return std::get< I >( m_pages.get( pos / PageSize )->data )[ pos % PageSize ];
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < size_t I >
+const typename Fields::template field_type< I >& soa_vector< T, PageSize, Fields, Allocator >::field( const size_t pos ) const noexcept {
+  assert( exist( pos ) );
+  return std::get< I >( m_pages.get( pos / PageSize )->data )[ pos % PageSize ];
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+std::pair< size_t, size_t > soa_vector< T, PageSize, Fields, Allocator >::index_range() const {
+  auto result = std::make_pair( bad_index, bad_index );
+
+  const size_t first_page = m_pages.next( 0 );
+  if ( first_page == page_table::npos ) {
+    return result;
+  }
+
+  // empty pages are erased, so the first and last pages hold the bounds
+  const auto first = m_pages.get( first_page );
+  for ( size_t w = 0; w < mask_words; ++w ) {
+    if ( first->mask[ w ] ) {
+      result.first = first_page * PageSize + w * 64 + count_trailing_zeros( first->mask[ w ] );
+      break;
+    }
+  }
+
+  const size_t last_page = m_pages.prev( m_pages.size() );
+  const auto last = m_pages.get( last_page );
+  for ( size_t w = mask_words; w > 0; --w ) {
+    if ( last->mask[ w - 1 ] ) {
+      result.second = last_page * PageSize + ( w - 1 ) * 64 + 63 - count_leading_zeros( last->mask[ w - 1 ] );
+      break;
+    }
+  }
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < typename Ft >
+void soa_vector< T, PageSize, Fields, Allocator >::for_each_index( Ft&& f ) const {
+  for_each_index( 0, bad_index, std::forward< Ft >( f ) );
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < typename Ft >
+void soa_vector< T, PageSize, Fields, Allocator >::for_each_index( const size_t first, const size_t last, Ft&& f ) const {
+  for ( size_t page_idx = m_pages.next( first / PageSize ); page_idx < m_pages.size() && page_idx * PageSize < last; page_idx = m_pages.next( page_idx + 1 ) ) {
+    for ( size_t w = 0; w < mask_words; ++w ) {
+      uint64_t visited( 0 );
+      while ( true ) {
+        // page is fetched again on every step since f could erase it
+        const auto pg = get_page( page_idx );
+        if ( !pg ) {
+          break;
+        }
+
+        const uint64_t bits = pg->mask[ w ] & ~visited;
+        if ( !bits ) {
+          break;
+        }
+
+        const size_t bit = count_trailing_zeros( bits );
+        visited |= ( uint64_t( 2 ) << bit ) - 1;
+
+        // indices ascend, nothing is left past last
+        const size_t pos = page_idx * PageSize + w * 64 + bit;
+        if ( pos >= last ) {
+          return;
+        }
+
+        if ( pos >= first ) {
+          f( pos );
+        }
+      }
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < typename Ft >
+void soa_vector< T, PageSize, Fields, Allocator >::for_each_page( Ft&& f ) {
+  m_pages.for_each( [ &f ]( const size_t page_idx, page* pg ) {
+    f( page_idx * PageSize, pg->mask.data(), Fields::data( pg->data ) );
+  } );
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+template < typename Ft >
+void soa_vector< T, PageSize, Fields, Allocator >::for_each_page( Ft&& f ) const {
+  m_pages.for_each( [ &f ]( const size_t page_idx, const page* pg ) {
+    f( page_idx * PageSize, pg->mask.data(), Fields::data( pg->data ) );
+  } );
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+size_t soa_vector< T, PageSize, Fields, Allocator >::page_count() const {
+  return m_pages.size();
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+size_t soa_vector< T, PageSize, Fields, Allocator >::next_page( const size_t page_idx ) const {
+  const size_t result = m_pages.next( page_idx );
+  return result == page_table::npos ? bad_index : result;
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+const uint64_t* soa_vector< T, PageSize, Fields, Allocator >::page_mask( const size_t page_idx ) const {
+  const auto pg = get_page( page_idx );
+  return pg ? pg->mask.data() : nullptr;
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+typename soa_vector< T, PageSize, Fields, Allocator >::pointers soa_vector< T, PageSize, Fields, Allocator >::page_data( const size_t page_idx ) {
+  assert( get_page( page_idx ) );
+  return Fields::data( m_pages.get( page_idx )->data );
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+typename soa_vector< T, PageSize, Fields, Allocator >::const_pointers soa_vector< T, PageSize, Fields, Allocator >::page_data( const size_t page_idx ) const {
+  assert( get_page( page_idx ) );
+  const page* pg = m_pages.get( page_idx );
+  return Fields::data( pg->data );
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+void soa_vector< T, PageSize, Fields, Allocator >::touch( const size_t pos, const uint64_t version ) {
+  auto pg = get_page( pos / PageSize );
+  assert( pg );
+
+  pg->version = std::max( pg->version, version );
+}
+
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+uint64_t soa_vector< T, PageSize, Fields, Allocator >::page_version( const size_t page_idx ) const {
+  const auto pg = get_page( page_idx );
+  return pg ? pg->version : 0;
+}
+
+//=============================================================================
+//
+// soa_vector::page
+//
+//=============================================================================
+template < typename T, size_t PageSize, typename Fields, typename Allocator >
+soa_vector< T, PageSize, Fields, Allocator >::page::page():
+  data(),
+  size( 0 ),
+  version( 0 ) {
+  mask.fill( 0 );
+}
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "page_directory.h"
+#include "sparse_vector.h"
+#include "types.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ecs {
+
+// selects sparse_set as the storage of a component through
+// component_traits< T >::page_policy
+struct sparse_set_policy {};
+
+// classic sparse set: elements live in a single contiguous dense array with
+// a parallel array of their indices, pages of PageSize indices map an index
+// to its dense position; erase moves the last element into the gap, so
+// iteration over the dense array is a single linear sweep in no particular
+// order; references are invalidated by insert and erase
+template < typename T, size_t PageSize = 64, typename Allocator = std::allocator< T > >
+class sparse_set: public sparse_vector_base {
+public:
+  using allocator_type = Allocator;
+  using reference = T&;
+
+  static const size_t bad_index;
+
+  explicit sparse_set( const Allocator& alloc = Allocator() );
+  ~sparse_set();
+
+  sparse_set( const sparse_set& ) = delete;
+  sparse_set& operator= ( const sparse_set& ) = delete;
+
+  // modify
+  void clear();
+
+  T& insert( const size_t pos, const T& arg );
+
+  template < typename... Args >
+  T& emplace( const size_t pos, Args&&... args );
+
+  // insert or overwrite
+  T& set( const size_t pos, const T& arg );
+
+  void erase( const size_t pos ) override;
+
+  // same as sparse_vector ones
+  template < typename... Args >
+  void emplace_range( const size_t first, const size_t count, const Args&... args );
+
+  template < typename IdIt, typename ValueIt >
+  void insert_range( IdIt first, const IdIt last, ValueIt value );
+
+  void erase_range( const size_t first, const size_t last );
+
+  // room for count elements in the dense arrays
+  void reserve( const size_t count );
+
+  // access
+  bool exist( const size_t pos ) const noexcept;
+
+  size_t size() const;
+
+  T& get_unsafe( const size_t pos ) noexcept;
+  const T& get_unsafe( const size_t pos ) const noexcept;
+
+  // dense arrays, data()[ i ] is the element at index ids()[ i ]
+  T* data() noexcept;
+  const T* data() const noexcept;
+  const eid_t* ids() const noexcept;
+
+  // lowest and highest existing indices, bad_index if empty
+  std::pair< size_t, size_t > index_range() const;
+
+  // iterate over indices of existing elements in ascending order,
+  // f is allowed to modify the set
+  template < typename Ft >
+  void for_each_index( Ft&& f ) const;
+
+  // same for indices within [ first, last )
+  template < typename Ft >
+  void for_each_index( const size_t first, const size_t last, Ft&& f ) const;
+
+  // f( pos, element ) for every element in dense order,
+  // f must not insert or erase elements
+  template < typename Ft >
+  void for_each( Ft&& f );
+
+  template < typename Ft >
+  void for_each( Ft&& f ) const;
+
+  // page level change tracking of PageSize indices, see sparse_vector::touch
+  void touch( const size_t pos, const uint64_t version );
+  void touch_all( const uint64_t version );
+  uint64_t version( const size_t pos ) const;
+  uint64_t page_version( const size_t page_idx ) const;
+  size_t page_count() const;
+
+  // first existing page not less than page_idx, bad_index if there is none
+  size_t next_page( const size_t page_idx ) const;
+
+  // occupancy of indices [ first_word * 64, ( first_word + count ) * 64 ),
+  // bit i of out[ j ] tells if the element at ( first_word + j ) * 64 + i exists
+  void mask_words( const size_t first_word, const size_t count, uint64_t* out ) const;
+
+private:
+  struct page {
+    page();
+
+    static const size_t mask_words = ( PageSize + 63 ) / 64;
+
+    std::array< uint64_t, mask_words > mask;
+    std::array< eid_t, PageSize >      dense; // position in the dense arrays by slot
+    size_t                             size;
+    uint64_t                           version;
+  };
+
+  using page_allocator = typename std::allocator_traits< Allocator >::template rebind_alloc< page >;
+  using page_allocator_traits = std::allocator_traits< page_allocator >;
+  using page_table = page_directory< page, typename std::allocator_traits< Allocator >::template rebind_alloc< page* > >;
+  using dense_vector = std::vector< T, Allocator >;
+  using id_vector = std::vector< eid_t, typename std::allocator_traits< Allocator >::template rebind_alloc< eid_t > >;
+
+  page& get_or_create_page( const size_t page_idx );
+  page* get_page( const size_t page_idx ) const;
+  void erase_page( const size_t page_idx );
+
+  // map slot of pg to the element just appended to the dense arrays
+  void link( page& pg, const size_t slot );
+
+  page_allocator m_allocator;
+  page_table     m_pages;
+  dense_vector   m_dense;
+  id_vector      m_ids;
+};
+
+template < typename T, size_t PageSize, typename Allocator >
+const size_t sparse_set< T, PageSize, Allocator >::bad_index = std::numeric_limits< size_t >::max();
+
+}
+
+#include "sparse_set.hpp"
@@ -0,0 +1,390 @@
+#pragma once
+
+#include "bits.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ecs {
+
+//=============================================================================
+//
+// sparse_set
+//
+//=============================================================================
+template < typename T, size_t PageSize, typename Allocator >
+sparse_set< T, PageSize, Allocator >::sparse_set( const Allocator& alloc ):
+  m_allocator( alloc ),
+  m_pages( alloc ),
+  m_dense( alloc ),
+  m_ids( alloc ) {
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+sparse_set< T, PageSize, Allocator >::~sparse_set() {
+  clear();
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+inline typename sparse_set< T, PageSize, Allocator >::page& sparse_set< T, PageSize, Allocator >::get_or_create_page( const size_t page_idx ) {
+  page* pg = m_pages.get( page_idx );
+  if ( !pg ) {
+    pg = page_allocator_traits::allocate( m_allocator, 1 );
+    page_allocator_traits::construct( m_allocator, pg );
+    try {
+      m_pages.set( page_idx, pg );
+    } catch ( ... ) {
+      page_allocator_traits::destroy( m_allocator, pg );
+      page_allocator_traits::deallocate( m_allocator, pg, 1 );
+      throw;
+    }
+  }
+
+  return *pg;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+inline typename sparse_set< T, PageSize, Allocator >::page* sparse_set< T, PageSize, Allocator >::get_page( const size_t page_idx ) const {
+  return m_pages.get( page_idx );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void sparse_set< T, PageSize, Allocator >::erase_page( const size_t page_idx ) {
+  if ( page* pg = m_pages.release( page_idx ) ) {
+    page_allocator_traits::destroy( m_allocator, pg );
+    page_allocator_traits::deallocate( m_allocator, pg, 1 );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+inline void sparse_set< T, PageSize, Allocator >::link( page& pg, const size_t slot ) {
+  pg.mask[ slot / 64 ] |= uint64_t( 1 ) << ( slot % 64 );
+  pg.dense[ slot ] = static_cast< eid_t >( m_dense.size() - 1 );
+  ++pg.size;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void sparse_set< T, PageSize, Allocator >::clear() {
+  m_pages.for_each( [ this ]( const size_t page_idx, page* ) {
+    erase_page( page_idx );
+  } );
+
+  m_pages.clear();
+  dense_vector( m_dense.get_allocator() ).swap( m_dense );
+  id_vector( m_ids.get_allocator() ).swap( m_ids );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+T& sparse_set< T, PageSize, Allocator >::insert( const size_t pos, const T& arg ) {
+  return emplace( pos, arg );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename... Args >
+T& sparse_set< T, PageSize, Allocator >::emplace( const size_t pos, Args&&... args ) {
+  assert( pos <= std::numeric_limits< eid_t >::max() );
+
+  if ( exist( pos ) ) {
+    return m_dense[ get_page( pos / PageSize )->dense[ pos % PageSize ] ];
+  }
+
+  // the element is constructed before its page is created, so a throwing
+  // constructor leaves no empty page behind
+  m_ids.push_back( static_cast< eid_t >( pos ) );
+  try {
+    m_dense.emplace_back( std::forward< Args >( args )... );
+  } catch ( ... ) {
+    m_ids.pop_back();
+    throw;
+  }
+
+  try {
+    link( get_or_create_page( pos / PageSize ), pos % PageSize );
+  } catch ( ... ) {
+    m_dense.pop_back();
+    m_ids.pop_back();
+    throw;
+  }
+
+  return m_dense.back();
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+T& sparse_set< T, PageSize, Allocator >::set( const size_t pos, const T& arg ) {
+  if ( exist( pos ) ) {
+    return get_unsafe( pos ) = arg;
+  }
+
+  return emplace( pos, arg );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void sparse_set< T, PageSize, Allocator >::erase( const size_t pos ) {
+  assert( pos < bad_index );
+
+  const size_t page_idx = pos / PageSize;
+  auto pg = get_page( page_idx );
+  if ( !pg || !exist( pos ) ) {
+    return;
+  }
+
+  // the last element fills the gap
+  const size_t slot = pos % PageSize;
+  const eid_t idx = pg->dense[ slot ];
+  if ( idx + size_t( 1 ) != m_dense.size() ) {
+    const eid_t moved = m_ids.back();
+    m_dense[ idx ] = std::move( m_dense.back() );
+    m_ids[ idx ] = moved;
+    m_pages.get( moved / PageSize )->dense[ moved % PageSize ] = idx;
+  }
+
+  m_dense.pop_back();
+  m_ids.pop_back();
+
+  pg->mask[ slot / 64 ] &= ~( uint64_t( 1 ) << ( slot % 64 ) );
+  if ( --pg->size == 0 ) {
+    erase_page( page_idx );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename... Args >
+void sparse_set< T, PageSize, Allocator >::emplace_range( const size_t first, const size_t count, const Args&... args ) {
+  assert( count < bad_index - first );
+
+  reserve( m_dense.size() + count );
+  for ( size_t pos = first; pos < first + count; ++pos ) {
+    emplace( pos, args... );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename IdIt, typename ValueIt >
+void sparse_set< T, PageSize, Allocator >::insert_range( IdIt first, const IdIt last, ValueIt value ) {
+  for ( ; first != last; ++first, ++value ) {
+    insert( *first, *value );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void sparse_set< T, PageSize, Allocator >::erase_range( const size_t first, const size_t last ) {
+  for ( size_t page_idx = m_pages.next( first / PageSize ); first < last && page_idx < m_pages.size() && page_idx * PageSize < last; page_idx = m_pages.next( page_idx + 1 ) ) {
+    const size_t base = page_idx * PageSize;
+    const size_t lo = first > base ? first - base : 0;
+    const size_t hi = std::min( last - base, PageSize );
+
+    for ( size_t w = 0; w < page::mask_words; ++w ) {
+      // the page is gone once its last element is erased
+      const auto pg = get_page( page_idx );
+      if ( !pg ) {
+        break;
+      }
+
+      for ( uint64_t bits = pg->mask[ w ] & word_range_bits( w, lo, hi ); bits; bits &= bits - 1 ) {
+        erase( base + w * 64 + count_trailing_zeros( bits ) );
+      }
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void sparse_set< T, PageSize, Allocator >::reserve( const size_t count ) {
+  m_dense.reserve( count );
+  m_ids.reserve( count );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+bool sparse_set< T, PageSize, Allocator >::exist( const size_t pos ) const noexcept {
+  assert( pos < bad_index );
+
+  const auto pg = get_page( pos / PageSize );
+  const size_t slot = pos % PageSize;
+
+  return pg && ( pg->mask[ slot / 64 ] >> ( slot % 64 ) ) & 1;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t sparse_set< T, PageSize, Allocator >::size() const {
+  return m_dense.size();
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+T& sparse_set< T, PageSize, Allocator >::get_unsafe( const size_t pos ) noexcept {
+  assert( exist( pos ) );
+
+  return m_dense[ m_pages.get( pos / PageSize )->dense[ pos % PageSize ] ];
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+const T& sparse_set< T, PageSize, Allocator >::get_unsafe( const size_t pos ) const noexcept {
+  assert( exist( pos ) );
+
+  return m_dense[ m_pages.get( pos / PageSize )->dense[ pos % PageSize ] ];
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+T* sparse_set< T, PageSize, Allocator >::data() noexcept {
+  return m_dense.data();
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+const T* sparse_set< T, PageSize, Allocator >::data() const noexcept {
+  return m_dense.data();
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+const eid_t* sparse_set< T, PageSize, Allocator >::ids() const noexcept {
+  return m_ids.data();
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+std::pair< size_t, size_t > sparse_set< T, PageSize, Allocator >::index_range() const {
+  auto result = std::make_pair( bad_index, bad_index );
+  if ( m_dense.empty() ) {
+    return result;
+  }
+
+  // empty pages are erased, so the first and last pages hold the bounds
+  const size_t first_page = m_pages.next( 0 );
+  const auto first = m_pages.get( first_page );
+  for ( size_t w = 0; w < page::mask_words; ++w ) {
+    if ( first->mask[ w ] ) {
+      result.first = first_page * PageSize + w * 64 + count_trailing_zeros( first->mask[ w ] );
+      break;
+    }
+  }
+
+  const size_t last_page = m_pages.prev( m_pages.size() );
+  const auto last = m_pages.get( last_page );
+  for ( size_t w = page::mask_words; w > 0; --w ) {
+    if ( last->mask[ w - 1 ] ) {
+      result.second = last_page * PageSize + ( w - 1 ) * 64 + 63 - count_leading_zeros( last->mask[ w - 1 ] );
+      break;
+    }
+  }
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename Ft >
+void sparse_set< T, PageSize, Allocator >::for_each_index( Ft&& f ) const {
+  for_each_index( 0, bad_index, std::forward< Ft >( f ) );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename Ft >
+void sparse_set< T, PageSize, Allocator >::for_each_index( const size_t first, const size_t last, Ft&& f ) const {
+  for ( size_t page_idx = m_pages.next( first / PageSize ); page_idx < m_pages.size() && page_idx * PageSize < last; page_idx = m_pages.next( page_idx + 1 ) ) {
+    const size_t base = page_idx * PageSize;
+    const size_t lo = first > base ? first - base : 0;
+    const size_t hi = std::min( last - base, PageSize );
+
+    for ( size_t w = lo / 64; w * 64 < hi; ++w ) {
+      // the page is read again on every step since f could modify it
+      uint64_t visited( 0 );
+      while ( true ) {
+        const auto pg = get_page( page_idx );
+        const uint64_t bits = pg ? pg->mask[ w ] & word_range_bits( w, lo, hi ) & ~visited : 0;
+        if ( !bits ) {
+          break;
+        }
+
+        const size_t bit = count_trailing_zeros( bits );
+        visited |= ( uint64_t( 2 ) << bit ) - 1;
+
+        f( base + w * 64 + bit );
+      }
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename Ft >
+void sparse_set< T, PageSize, Allocator >::for_each( Ft&& f ) {
+  for ( size_t i = 0; i < m_dense.size(); ++i ) {
+    f( size_t( m_ids[ i ] ), m_dense[ i ] );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename Ft >
+void sparse_set< T, PageSize, Allocator >::for_each( Ft&& f ) const {
+  for ( size_t i = 0; i < m_dense.size(); ++i ) {
+    f( size_t( m_ids[ i ] ), m_dense[ i ] );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void sparse_set< T, PageSize, Allocator >::touch( const size_t pos, const uint64_t version ) {
+  auto pg = get_page( pos / PageSize );
+  assert( pg );
+
+  pg->version = std::max( pg->version, version );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void sparse_set< T, PageSize, Allocator >::touch_all( const uint64_t version ) {
+  m_pages.for_each( [ version ]( const size_t, page* pg ) {
+    pg->version = std::max( pg->version, version );
+  } );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+uint64_t sparse_set< T, PageSize, Allocator >::version( const size_t pos ) const {
+  return page_version( pos / PageSize );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+uint64_t sparse_set< T, PageSize, Allocator >::page_version( const size_t page_idx ) const {
+  const auto pg = get_page( page_idx );
+  return pg ? pg->version : 0;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t sparse_set< T, PageSize, Allocator >::page_count() const {
+  return m_pages.size();
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t sparse_set< T, PageSize, Allocator >::next_page( const size_t page_idx ) const {
+  const size_t result = m_pages.next( page_idx );
+  return result == page_table::npos ? bad_index : result;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void sparse_set< T, PageSize, Allocator >::mask_words( const size_t first_word, const size_t count, uint64_t* out ) const {
+  for ( size_t i = 0; i < count; ++i ) {
+    const size_t base = ( first_word + i ) * 64;
+    uint64_t result( 0 );
+
+    // same stitching as sparse_vector::mask_words
+    for ( size_t bit = 0; bit < 64; ) {
+      const size_t slot = ( base + bit ) % PageSize;
+      const size_t n = std::min( std::min( PageSize - slot, 64 - bit ), 64 - slot % 64 );
+
+      const auto pg = get_page( ( base + bit ) / PageSize );
+      if ( pg ) {
+        result |= ( ( pg->mask[ slot / 64 ] >> ( slot % 64 ) ) & low_bits( n ) ) << bit;
+      }
+
+      bit += n;
+    }
+
+    out[ i ] = result;
+  }
+}
+
+//=============================================================================
+//
+// sparse_set::page
+//
+//=============================================================================
+template < typename T, size_t PageSize, typename Allocator >
+sparse_set< T, PageSize, Allocator >::page::page():
+  size( 0 ),
+  version( 0 ) {
+  mask.fill( 0 );
+}
+
+}
@@ -1,8 +1,14 @@
 #pragma once
 
+#include "bits.h"
+#include "page_directory.h"
+
 #include <array>
+#include <cstddef>
 #include <vector>
 #include <limits>
+#include <memory>
+#include <type_traits>
 
 namespace ecs {
 
@@ -12,10 +18,43 @@ public:
   virtual void erase( const size_t pos ) = 0;
 };
 
-template < typename T, size_t PageSize = 64 >
+// smallest unsigned type able to hold any in-page index and a sentinel
+template < size_t PageSize >
+struct page_index {
+  using type =
+    typename std::conditional< ( PageSize <= std::numeric_limits< uint8_t >::max() ), uint8_t,
+    typename std::conditional< ( PageSize <= std::numeric_limits< uint16_t >::max() ), uint16_t,
+    typename std::conditional< ( PageSize <= std::numeric_limits< uint32_t >::max() ), uint32_t,
+      size_t >::type >::type >::type;
+};
+
+// page storage policies
+// elements of a page are kept ordered by index, insert and erase shift the tail
+struct ordered_page_policy {};
+// elements of a page are kept in insertion order, erase moves the last element
+// into the gap, so insert and erase are O(1) while iteration order is arbitrary
+struct unordered_page_policy {};
+
+struct page_pool_stats {
+  size_t hits;   // pages taken from the pool
+  size_t misses; // pages allocated because the pool was empty
+};
+
+template < typename T, size_t PageSize = 64, typename Policy = ordered_page_policy, typename Allocator = std::allocator< T > >
 class sparse_vector: public sparse_vector_base {
 public:
+  using index_type = typename page_index< PageSize >::type;
+  using allocator_type = Allocator;
+  using reference = T&;
+
   static const size_t bad_index;
+  static const size_t default_page_pool_capacity = 8;
+
+  explicit sparse_vector( const Allocator& alloc = Allocator() );
+  ~sparse_vector();
+
+  sparse_vector( const sparse_vector& ) = delete;
+  sparse_vector& operator= ( const sparse_vector& ) = delete;
 
   // modify
   void clear();
@@ -25,11 +64,30 @@ public:
   template < typename... Args >
   T& emplace( const size_t pos, Args&&... args );
 
+  // insert or overwrite
+  T& set( const size_t pos, const T& arg );
+
   void erase( const size_t pos ) override;
 
+  // emplace an element constructed from args at every index of
+  // [ first, first + count ), existing elements are left intact
+  template < typename... Args >
+  void emplace_range( const size_t first, const size_t count, const Args&... args );
+
+  // insert *value++ at every id of [ first, last ), existing elements
+  // are left intact, ids are traversed twice
+  template < typename IdIt, typename ValueIt >
+  void insert_range( IdIt first, const IdIt last, ValueIt value );
+
+  // erase elements at indices [ first, last ), whole pages are dropped at once
+  void erase_range( const size_t first, const size_t last );
+
   // access
   bool exist( const size_t pos ) const noexcept;
 
+  // number of elements, O(1)
+  size_t size() const;
+
   // totally unsafe access
   T& get_unsafe( const size_t pos ) noexcept;
   const T& get_unsafe( const size_t pos ) const noexcept;
@@ -37,14 +95,134 @@ public:
   // safe access with on-access creation
   T& operator[] ( const size_t pos );
 
+  // lowest and highest existing indices, bad_index if empty, O(1)
   std::pair< size_t, size_t > index_range() const;
 
+  // iterate over indices of existing elements in ascending order,
+  // f is allowed to modify the vector
+  template < typename Ft >
+  void for_each_index( Ft&& f ) const;
+
+  // same for indices within [ first, last )
+  template < typename Ft >
+  void for_each_index( const size_t first, const size_t last, Ft&& f ) const;
+
+  // iterate over densely packed elements page by page,
+  // f( base_pos, data, back_index, count ) is called for every non-empty page,
+  // data[ i ] is the element at base_pos + back_index[ i ],
+  // f must not insert or erase elements
+  template < typename Ft >
+  void for_each_page( Ft&& f );
+
+  template < typename Ft >
+  void for_each_page( Ft&& f ) const;
+
+  // f( pos, element ) for every existing element, built on for_each_page
+  template < typename Ft >
+  void for_each( Ft&& f );
+
+  template < typename Ft >
+  void for_each( Ft&& f ) const;
+
   void reserve( const size_t count );
 
+  // replace elements of page dst_page with copies of those of page src_page
+  // of other, keeping their slots and places; pages of trivially copyable T
+  // are copied by a single memcpy; group prefix and versions are not copied
+  void copy_page( const sparse_vector& other, const size_t src_page, const size_t dst_page );
+
+  // replace all elements with copies of those of other, page by page
+  void copy_from( const sparse_vector& other );
+
+  // raw page images for snapshots, trivially copyable T only: save passes
+  // index tables, occupancy mask and elements of every page to
+  // out.write( data, bytes ), load replaces all elements with pages taken
+  // from in.read( bytes ), which returns a pointer to the next bytes;
+  // group prefix and versions are not saved; load checks framing, counts
+  // and index tables of images and throws std::runtime_error on a mismatch
+  // leaving the vector empty, elements themselves are trusted
+  template < typename Out >
+  void save( Out& out ) const;
+
+  template < typename In >
+  void load( In& in );
+
+  // pages left empty are kept for reuse, up to count of them
+  void set_page_pool_capacity( const size_t count );
+  size_t page_pool_capacity() const;
+
+  const page_pool_stats& pool_stats() const;
+
+  // owning group support, unordered_page_policy only: the first
+  // page_group_size( page_idx ) elements of a page form the group prefix,
+  // owning_group keeps prefixes of its storages in the same order
+  void group_add( const size_t pos );    // element must exist outside the prefix
+  void group_remove( const size_t pos ); // element must be in the prefix
+  bool in_group( const size_t pos ) const;
+
+  // unordered_page_policy only: elements are rearranged within their pages,
+  // indices stay, for_each_page and for_each walk pages in the new order;
+  // places of the group prefix are left as they are
+
+  // sort every page by compare( const T&, const T& )
+  template < typename Compare >
+  void sort( Compare compare );
+
+  // elements existing in other come first and in the order they have there
+  template < typename U, typename UPolicy, typename UAllocator >
+  void sort_as( const sparse_vector< U, PageSize, UPolicy, UAllocator >& other );
+
+  // move the element at place order[ i ] of the page to place first + i,
+  // order is a permutation of [ first, first + count )
+  void reorder_page( const size_t page_idx, const size_t first, const size_t* order, const size_t count );
+
+  // change tracking, versions come from the caller and only grow:
+  // a page remembers the last version it was touched with, slots do
+  // as well once tracking of slot versions is on
+  void touch( const size_t pos, const uint64_t version );
+  void touch_all( const uint64_t version );
+  uint64_t version( const size_t pos ) const;
+
+  void track_slot_versions( const bool enable );
+  bool slot_versions_tracked() const;
+
+  // occupancy of indices [ first_word * 64, ( first_word + count ) * 64 ),
+  // bit i of out[ j ] tells if the element at ( first_word + j ) * 64 + i exists
+  void mask_words( const size_t first_word, const size_t count, uint64_t* out ) const;
+
+  // page level access, nullptr or 0 if the page does not exist;
+  // pages are kept in a page_directory, page_count is one past the
+  // highest page index ever used
+  size_t page_count() const;
+
+  // first existing page not less than page_idx, bad_index if there is none
+  size_t next_page( const size_t page_idx ) const;
+  uint64_t page_version( const size_t page_idx ) const;
+  T* page_data( const size_t page_idx );
+  const index_type* page_back_index( const size_t page_idx ) const;
+  size_t page_group_size( const size_t page_idx ) const;
+
 private:
+  using slot_versions = std::array< uint64_t, PageSize >;
+  using slot_allocator = typename std::allocator_traits< Allocator >::template rebind_alloc< slot_versions >;
+  using slot_allocator_traits = std::allocator_traits< slot_allocator >;
+
+  // returns slot versions to the allocator they came from
+  struct slot_deleter {
+    explicit slot_deleter( const slot_allocator& alloc );
+
+    void operator()( slot_versions* versions );
+
+    slot_allocator allocator;
+  };
+
   class page {
   public:
-    page();
+    explicit page( const slot_allocator& alloc );
+    ~page();
+
+    // destroy all elements
+    void clear();
 
     T& insert( const size_t pos, const T& arg );
 
@@ -55,35 +233,146 @@ private:
 
     bool exist( const size_t pos ) const noexcept;
 
+    // occupancy of indices [ w * 64, w * 64 + 64 ) of the page
+    uint64_t mask( const size_t w ) const noexcept;
+
     T& operator[] ( const size_t pos );
 
     T& get_unsafe( const size_t pos ) noexcept;
     const T& get_unsafe( const size_t pos ) const noexcept;
 
-    size_t min_index() const;
-    size_t max_index() const;
+    // first existing index not less than pos
+    size_t next_index( const size_t pos ) const;
+
+    // last existing index not greater than pos
+    size_t prev_index( const size_t pos ) const;
 
     size_t size() const;
 
+    // elements at places [ 0, group_size ) are members of the owning group
+    void group_add( const size_t pos );
+    void group_remove( const size_t pos );
+    bool in_group( const size_t pos ) const;
+    size_t group_size() const;
+
+    size_t place( const size_t pos ) const noexcept;
+    void reorder( const size_t first, const size_t* order, const size_t count );
+
+    void touch( const size_t pos, const uint64_t version, const bool slot );
+    uint64_t version() const;
+    uint64_t version( const size_t pos ) const;
+
+    T* data() noexcept;
+    const T* data() const noexcept;
+    const index_type* back_index() const noexcept;
+
+    // copy elements and layout of other, the page must be empty
+    void assign( const page& other );
+
+    // image of the page, load expects count elements and an empty page,
+    // which is left empty if the image is inconsistent
+    template < typename Out >
+    void save( const size_t page_idx, Out& out ) const;
+
+    template < typename In >
+    void load( const size_t count, In& in );
+
   private:
+    static const size_t mask_words = ( PageSize + 63 ) / 64;
+
+    // elements of trivially copyable types are shifted and copied by memmove
+    // and memcpy, trivially destructible ones are never destroyed one by one
+    using trivially_copyable = std::integral_constant< bool, std::is_trivially_copyable< T >::value >;
+    using trivially_destructible = std::integral_constant< bool, std::is_trivially_destructible< T >::value >;
+
+    // move count elements from places [ src, src + count ) to [ dst, dst + count ),
+    // places which are left are destroyed
+    void relocate( const size_t dst, const size_t src, const size_t count, std::true_type );
+    void relocate( const size_t dst, const size_t src, const size_t count, std::false_type );
+
+    // destroy elements at places [ first, last )
+    void destroy( const size_t first, const size_t last, std::true_type );
+    void destroy( const size_t first, const size_t last, std::false_type );
+
+    void swap_elements( const size_t a, const size_t b, std::true_type );
+    void swap_elements( const size_t a, const size_t b, std::false_type );
+
+    void copy_elements( const page& other, std::true_type );
+    void copy_elements( const page& other, std::false_type );
+
     template < typename... Args >
     void take_place( const size_t pos, Args&&... args );
 
-    std::array< size_t, PageSize >                                   m_index;
-    std::array< size_t, PageSize >                                   m_back_index;
+    size_t insert_place( const size_t pos, ordered_page_policy ) const;
+    size_t insert_place( const size_t pos, unordered_page_policy ) const;
+
+    // fill the gap left by the destroyed element at place
+    void close_gap( const size_t place, ordered_page_policy );
+    void close_gap( const size_t place, unordered_page_policy );
+
+    // whether index tables and mask describe count elements, checked on load
+    bool consistent( const size_t count, ordered_page_policy ) const;
+    bool consistent( const size_t count, unordered_page_policy ) const;
+
+    // count of existing indices less than pos
+    size_t rank( const size_t pos ) const;
+
+    void swap_places( const size_t a, const size_t b );
+
+    std::array< index_type, PageSize >                               m_index;
+    std::array< index_type, PageSize >                               m_back_index;
+    std::array< uint64_t, mask_words >                               m_mask;
     typename std::aligned_storage< sizeof( T ), alignof( T ) >::type m_data[ PageSize ];
     size_t                                                           m_size;
+    size_t                                                           m_group;
+    uint64_t                                                         m_version;
+    std::unique_ptr< slot_versions, slot_deleter >                   m_slot_versions;
   };
 
+  using page_allocator = typename std::allocator_traits< Allocator >::template rebind_alloc< page >;
+  using page_allocator_traits = std::allocator_traits< page_allocator >;
+  using page_table = std::vector< page*, typename std::allocator_traits< Allocator >::template rebind_alloc< page* > >;
+  using page_directory_type = page_directory< page, typename std::allocator_traits< Allocator >::template rebind_alloc< page* > >;
+
+  static const index_type bad_page_index;
+
   page& get_or_create_page( const size_t page_idx );
   page* get_page( const size_t page_idx ) const;
   void erase_page( const size_t page_idx );
 
-  std::vector< page* > m_pages;
+  // keep size and index range up to date
+  void on_inserted( const size_t pos );
+  void on_erased( const size_t pos );
+
+  // account for elements of a page filled at once
+  void on_page_filled( const size_t page_idx );
+
+  // first existing index not less than pos, last not greater than pos
+  size_t find_next( const size_t pos ) const;
+  size_t find_prev( const size_t pos ) const;
+
+  page* acquire_page();
+  void release_page( page* pg );
+
+  page* new_page();
+  void delete_page( page* pg );
+
+  page_allocator      m_allocator;
+  page_directory_type m_pages;
+  page_table          m_free_pages;
+  size_t              m_page_pool_capacity;
+  page_pool_stats     m_pool_stats;
+  size_t              m_size;
+  size_t              m_min;
+  size_t              m_max;
+  bool                m_track_slots;
 };
 
-template < typename T, size_t PageSize >
-const size_t sparse_vector< T, PageSize >::bad_index = std::numeric_limits< size_t >::max();
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+const size_t sparse_vector< T, PageSize, Policy, Allocator >::bad_index = std::numeric_limits< size_t >::max();
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+const typename sparse_vector< T, PageSize, Policy, Allocator >::index_type sparse_vector< T, PageSize, Policy, Allocator >::bad_page_index = std::numeric_limits< index_type >::max();
 
 }
 
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
 
 namespace ecs {
 
@@ -10,62 +13,241 @@ namespace ecs {
 // sparse_vector
 //
 //=============================================================================
-template < typename T, size_t PageSize >
-inline typename sparse_vector< T, PageSize >::page& sparse_vector< T, PageSize >::get_or_create_page( const size_t page_idx ) {
-  if ( m_pages.size() <= page_idx ) {
-    m_pages.resize( page_idx + 1, nullptr );
-  }
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+sparse_vector< T, PageSize, Policy, Allocator >::sparse_vector( const Allocator& alloc ):
+  m_allocator( alloc ),
+  m_pages( alloc ),
+  m_free_pages( alloc ),
+  m_page_pool_capacity( default_page_pool_capacity ),
+  m_pool_stats{ 0, 0 },
+  m_size( 0 ),
+  m_min( bad_index ),
+  m_max( bad_index ),
+  m_track_slots( false ) {
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+sparse_vector< T, PageSize, Policy, Allocator >::~sparse_vector() {
+  clear();
+  set_page_pool_capacity( 0 );
+}
 
-  if ( !m_pages[ page_idx ] ) {
-    m_pages[ page_idx ] = new page();
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+inline typename sparse_vector< T, PageSize, Policy, Allocator >::page& sparse_vector< T, PageSize, Policy, Allocator >::get_or_create_page( const size_t page_idx ) {
+  page* pg = m_pages.get( page_idx );
+  if ( !pg ) {
+    pg = acquire_page();
+    try {
+      m_pages.set( page_idx, pg );
+    } catch ( ... ) {
+      release_page( pg );
+      throw;
+    }
   }
 
-  return *m_pages[ page_idx ];
+  return *pg;
 }
 
-template < typename T, size_t PageSize >
-inline typename sparse_vector< T, PageSize >::page* sparse_vector< T, PageSize >::get_page( const size_t page_idx ) const {
-  page* result( nullptr );
-  if ( m_pages.size() > page_idx ) {
-    result = m_pages[ page_idx ];
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+inline typename sparse_vector< T, PageSize, Policy, Allocator >::page* sparse_vector< T, PageSize, Policy, Allocator >::acquire_page() {
+  if ( m_free_pages.empty() ) {
+    ++m_pool_stats.misses;
+    return new_page();
   }
 
+  ++m_pool_stats.hits;
+  page* result = m_free_pages.back();
+  m_free_pages.pop_back();
+
   return result;
 }
 
-template < typename T, size_t PageSize >
-T& sparse_vector< T, PageSize >::insert( const size_t pos, const T& arg ) {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+inline typename sparse_vector< T, PageSize, Policy, Allocator >::page* sparse_vector< T, PageSize, Policy, Allocator >::new_page() {
+  page* result = page_allocator_traits::allocate( m_allocator, 1 );
+  page_allocator_traits::construct( m_allocator, result, slot_allocator( m_allocator ) );
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+inline void sparse_vector< T, PageSize, Policy, Allocator >::delete_page( page* pg ) {
+  page_allocator_traits::destroy( m_allocator, pg );
+  page_allocator_traits::deallocate( m_allocator, pg, 1 );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+inline void sparse_vector< T, PageSize, Policy, Allocator >::release_page( page* pg ) {
+  assert( pg->size() == 0 );
+
+  if ( m_free_pages.size() < m_page_pool_capacity ) {
+    m_free_pages.push_back( pg );
+  } else {
+    delete_page( pg );
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+inline typename sparse_vector< T, PageSize, Policy, Allocator >::page* sparse_vector< T, PageSize, Policy, Allocator >::get_page( const size_t page_idx ) const {
+  return m_pages.get( page_idx );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T& sparse_vector< T, PageSize, Policy, Allocator >::insert( const size_t pos, const T& arg ) {
   assert( pos < bad_index );
 
   auto& pg = get_or_create_page( pos / PageSize );
-  return pg.insert( pos % PageSize, arg );
+  if ( pg.exist( pos % PageSize ) ) {
+    return pg.get_unsafe( pos % PageSize );
+  }
+
+  T& result = pg.insert( pos % PageSize, arg );
+  on_inserted( pos );
+
+  return result;
 }
 
-template < typename T, size_t PageSize >
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
 template < typename... Args >
-T& sparse_vector< T, PageSize >::emplace( const size_t pos, Args&&... args ) {
+T& sparse_vector< T, PageSize, Policy, Allocator >::emplace( const size_t pos, Args&&... args ) {
   assert( pos < bad_index );
 
   auto& pg = get_or_create_page( pos / PageSize );
-  return pg.emplace( pos % PageSize, std::forward< Args >( args )... );
+  if ( pg.exist( pos % PageSize ) ) {
+    return pg.get_unsafe( pos % PageSize );
+  }
+
+  T& result = pg.emplace( pos % PageSize, std::forward< Args >( args )... );
+  on_inserted( pos );
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T& sparse_vector< T, PageSize, Policy, Allocator >::set( const size_t pos, const T& arg ) {
+  assert( pos < bad_index );
+
+  auto& pg = get_or_create_page( pos / PageSize );
+  if ( pg.exist( pos % PageSize ) ) {
+    return pg.get_unsafe( pos % PageSize ) = arg;
+  }
+
+  T& result = pg.insert( pos % PageSize, arg );
+  on_inserted( pos );
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename... Args >
+void sparse_vector< T, PageSize, Policy, Allocator >::emplace_range( const size_t first, const size_t count, const Args&... args ) {
+  if ( count == 0 ) {
+    return;
+  }
+
+  assert( count < bad_index - first );
+
+  const size_t last = first + count;
+
+  size_t pos = first;
+  while ( pos < last ) {
+    auto& pg = get_or_create_page( pos / PageSize );
+    const size_t page_end = std::min( last, ( pos / PageSize + 1 ) * PageSize );
+    for ( ; pos < page_end; ++pos ) {
+      if ( !pg.exist( pos % PageSize ) ) {
+        pg.emplace( pos % PageSize, args... );
+        on_inserted( pos );
+      }
+    }
+  }
 }
 
-template < typename T, size_t PageSize >
-void sparse_vector< T, PageSize >::erase( const size_t pos ) {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename IdIt, typename ValueIt >
+void sparse_vector< T, PageSize, Policy, Allocator >::insert_range( IdIt first, const IdIt last, ValueIt value ) {
+  if ( first == last ) {
+    return;
+  }
+
+  page* pg( nullptr );
+  size_t page_idx( bad_index );
+  for ( ; first != last; ++first, ++value ) {
+    const size_t pos = *first;
+    assert( pos < bad_index );
+
+    // consecutive ids usually share a page
+    if ( pos / PageSize != page_idx ) {
+      page_idx = pos / PageSize;
+      pg = &get_or_create_page( page_idx );
+    }
+
+    if ( !pg->exist( pos % PageSize ) ) {
+      pg->insert( pos % PageSize, *value );
+      on_inserted( pos );
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::erase_range( const size_t first, const size_t last ) {
+  if ( first >= last || m_size == 0 ) {
+    return;
+  }
+
+  for ( size_t page_idx = m_pages.next( first / PageSize ); page_idx < m_pages.size() && page_idx * PageSize < last; page_idx = m_pages.next( page_idx + 1 ) ) {
+    page* pg = m_pages.get( page_idx );
+    const size_t base = page_idx * PageSize;
+    if ( first <= base && last - base >= PageSize ) {
+      // whole page is covered
+      m_size -= pg->size();
+      pg->clear();
+    } else {
+      const size_t end = std::min( last - base, PageSize );
+      for ( size_t slot = pg->next_index( std::max( first, base ) - base ); slot < end; slot = pg->next_index( slot + 1 ) ) {
+        pg->erase( slot );
+        --m_size;
+      }
+    }
+
+    if ( pg->size() == 0 ) {
+      erase_page( page_idx );
+    }
+  }
+
+  if ( m_size == 0 ) {
+    m_min = bad_index;
+    m_max = bad_index;
+    return;
+  }
+
+  if ( m_min >= first && m_min < last ) {
+    m_min = find_next( last );
+  }
+
+  // something is left below first if the highest element was erased
+  if ( m_max >= first && m_max < last ) {
+    m_max = find_prev( first - 1 );
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::erase( const size_t pos ) {
   assert( pos < bad_index );
 
   size_t page_idx = pos / PageSize;
   auto pg = get_page( page_idx );
-  if ( pg ) {
+  if ( pg && pg->exist( pos % PageSize ) ) {
     pg->erase( pos % PageSize );
     if ( pg->size() == 0 ) {
       erase_page( page_idx );
     }
+
+    on_erased( pos );
   }
 }
 
-template < typename T, size_t PageSize >
-bool sparse_vector< T, PageSize >::exist( const size_t pos ) const noexcept {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+bool sparse_vector< T, PageSize, Policy, Allocator >::exist( const size_t pos ) const noexcept {
   assert( pos < bad_index );
 
   bool result( false );
@@ -78,252 +260,1043 @@ bool sparse_vector< T, PageSize >::exist( const size_t pos ) const noexcept {
   return result;
 }
 
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::size() const {
+  return m_size;
+}
+
 // totally unsafe access
-template < typename T, size_t PageSize >
-T& sparse_vector< T, PageSize >::get_unsafe( const size_t pos ) noexcept {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T& sparse_vector< T, PageSize, Policy, Allocator >::get_unsafe( const size_t pos ) noexcept {
   assert( pos < bad_index );
-  assert( m_pages[ pos / PageSize ] );
+  assert( m_pages.get( pos / PageSize ) );
 
-  return m_pages[ pos / PageSize ]->get_unsafe( pos % PageSize );
+  return m_pages.get( pos / PageSize )->get_unsafe( pos % PageSize );
 }
 
-template < typename T, size_t PageSize >
-const T& sparse_vector< T, PageSize >::get_unsafe( const size_t pos ) const noexcept {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+const T& sparse_vector< T, PageSize, Policy, Allocator >::get_unsafe( const size_t pos ) const noexcept {
   assert( pos < bad_index );
-  assert( m_pages[ pos / PageSize ] );
+  assert( m_pages.get( pos / PageSize ) );
 
-  return m_pages[ pos / PageSize ]->get_unsafe( pos % PageSize );
+  return m_pages.get( pos / PageSize )->get_unsafe( pos % PageSize );
 }
 
 // safe access with on-access creation
-template < typename T, size_t PageSize >
-T& sparse_vector< T, PageSize >::operator[] ( const size_t pos ) {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T& sparse_vector< T, PageSize, Policy, Allocator >::operator[] ( const size_t pos ) {
   assert( pos < bad_index );
 
   auto& pg = get_or_create_page( pos / PageSize );
-  return pg[ pos % PageSize ];
+  if ( pg.exist( pos % PageSize ) ) {
+    return pg.get_unsafe( pos % PageSize );
+  }
+
+  T& result = pg[ pos % PageSize ];
+  on_inserted( pos );
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+std::pair< size_t, size_t > sparse_vector< T, PageSize, Policy, Allocator >::index_range() const {
+  return std::make_pair( m_min, m_max );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Ft >
+void sparse_vector< T, PageSize, Policy, Allocator >::for_each_index( Ft&& f ) const {
+  for_each_index( 0, bad_index, std::forward< Ft >( f ) );
 }
 
-template < typename T, size_t PageSize >
-std::pair< size_t, size_t > sparse_vector< T, PageSize >::index_range() const {
-  auto result = std::make_pair( bad_index, bad_index );
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Ft >
+void sparse_vector< T, PageSize, Policy, Allocator >::for_each_index( const size_t first, const size_t last, Ft&& f ) const {
+  for ( size_t page_idx = m_pages.next( first / PageSize ); page_idx < m_pages.size() && page_idx * PageSize < last; page_idx = m_pages.next( page_idx + 1 ) ) {
+    const size_t base = page_idx * PageSize;
+    const size_t end = std::min( last - base, PageSize );
+
+    size_t i = first > base ? first - base : 0;
+    while ( i < end ) {
+      // page is fetched again on every step since f could erase it
+      const auto pg = get_page( page_idx );
+      if ( !pg ) {
+        break;
+      }
+
+      i = pg->next_index( i );
+      if ( i >= end ) {
+        break;
+      }
 
-  if ( m_pages.size() == 0 ) {
-    return result;
+      f( base + i );
+      ++i;
+    }
   }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Ft >
+void sparse_vector< T, PageSize, Policy, Allocator >::for_each_page( Ft&& f ) {
+  m_pages.for_each( [ &f ]( const size_t page_idx, page* pg ) {
+    if ( pg->size() != 0 ) {
+      f( page_idx * PageSize, pg->data(), pg->back_index(), pg->size() );
+    }
+  } );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Ft >
+void sparse_vector< T, PageSize, Policy, Allocator >::for_each_page( Ft&& f ) const {
+  m_pages.for_each( [ &f ]( const size_t page_idx, const page* pg ) {
+    if ( pg->size() != 0 ) {
+      f( page_idx * PageSize, pg->data(), pg->back_index(), pg->size() );
+    }
+  } );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Ft >
+void sparse_vector< T, PageSize, Policy, Allocator >::for_each( Ft&& f ) {
+  for_each_page( [ &f ]( const size_t base, T* data, const index_type* back_index, const size_t count ) {
+    for ( size_t i = 0; i < count; ++i ) {
+      f( base + back_index[ i ], data[ i ] );
+    }
+  } );
+}
 
-  for ( size_t i = 0; i < m_pages.size(); ++i ) {
-    if ( m_pages[ i ] ) {
-      result.first = m_pages[ i ]->min_index() + ( i * PageSize );
-      break;
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Ft >
+void sparse_vector< T, PageSize, Policy, Allocator >::for_each( Ft&& f ) const {
+  for_each_page( [ &f ]( const size_t base, const T* data, const index_type* back_index, const size_t count ) {
+    for ( size_t i = 0; i < count; ++i ) {
+      f( base + back_index[ i ], data[ i ] );
     }
+  } );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::clear() {
+  m_pages.for_each( [ this ]( const size_t, page* pg ) {
+    pg->clear();
+    release_page( pg );
+  } );
+
+  m_pages.clear();
+
+  m_size = 0;
+  m_min = bad_index;
+  m_max = bad_index;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::erase_page( const size_t page_idx ) {
+  if ( page* pg = m_pages.release( page_idx ) ) {
+    release_page( pg );
   }
+}
 
-  for ( size_t i = m_pages.size(); i > 0; --i ) {
-    if ( m_pages[ i - 1 ] ) {
-      auto max_index = m_pages[ i - 1 ]->max_index();
-      if ( max_index != bad_index ) {
-        result.second = max_index + ( ( i - 1 ) * PageSize );
-        break;
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::group_add( const size_t pos ) {
+  static_assert( std::is_same< Policy, unordered_page_policy >::value, "owning groups require unordered_page_policy" );
+
+  auto pg = get_page( pos / PageSize );
+  assert( pg );
+
+  pg->group_add( pos % PageSize );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Compare >
+void sparse_vector< T, PageSize, Policy, Allocator >::sort( Compare compare ) {
+  static_assert( std::is_same< Policy, unordered_page_policy >::value, "sorting requires unordered_page_policy" );
+
+  std::vector< size_t > order;
+  m_pages.for_each( [ & ]( const size_t, page* pg ) {
+    if ( pg->size() - pg->group_size() < 2 ) {
+      return;
+    }
+
+    order.resize( pg->size() - pg->group_size() );
+    for ( size_t i = 0; i < order.size(); ++i ) {
+      order[ i ] = pg->group_size() + i;
+    }
+
+    const T* data = pg->data();
+    std::stable_sort( order.begin(), order.end(), [ &compare, data ]( const size_t a, const size_t b ) {
+      return compare( data[ a ], data[ b ] );
+    } );
+
+    pg->reorder( pg->group_size(), order.data(), order.size() );
+  } );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename U, typename UPolicy, typename UAllocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::sort_as( const sparse_vector< U, PageSize, UPolicy, UAllocator >& other ) {
+  static_assert( std::is_same< Policy, unordered_page_policy >::value, "sorting requires unordered_page_policy" );
+
+  using other_index = typename sparse_vector< U, PageSize, UPolicy, UAllocator >::index_type;
+
+  std::vector< size_t > order;
+  std::vector< bool > taken;
+  other.for_each_page( [ & ]( const size_t base, const U*, const other_index* back_index, const size_t count ) {
+    const auto pg = get_page( base / PageSize );
+    if ( !pg ) {
+      return;
+    }
+
+    const size_t first = pg->group_size();
+    order.clear();
+    taken.assign( pg->size(), false );
+
+    for ( size_t i = 0; i < count; ++i ) {
+      if ( pg->exist( back_index[ i ] ) && pg->place( back_index[ i ] ) >= first ) {
+        order.push_back( pg->place( back_index[ i ] ) );
+        taken[ order.back() ] = true;
+      }
+    }
+
+    for ( size_t place = first; place < pg->size(); ++place ) {
+      if ( !taken[ place ] ) {
+        order.push_back( place );
       }
     }
+
+    pg->reorder( first, order.data(), order.size() );
+  } );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::reorder_page( const size_t page_idx, const size_t first, const size_t* order, const size_t count ) {
+  static_assert( std::is_same< Policy, unordered_page_policy >::value, "sorting requires unordered_page_policy" );
+
+  auto pg = get_page( page_idx );
+  assert( pg );
+  assert( first + count <= pg->size() );
+
+  pg->reorder( first, order, count );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::group_remove( const size_t pos ) {
+  auto pg = get_page( pos / PageSize );
+  assert( pg );
+
+  pg->group_remove( pos % PageSize );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+bool sparse_vector< T, PageSize, Policy, Allocator >::in_group( const size_t pos ) const {
+  const auto pg = get_page( pos / PageSize );
+  return pg && pg->in_group( pos % PageSize );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::touch( const size_t pos, const uint64_t version ) {
+  auto pg = get_page( pos / PageSize );
+  assert( pg );
+
+  pg->touch( pos % PageSize, version, m_track_slots );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::touch_all( const uint64_t version ) {
+  m_pages.for_each( [ this, version ]( const size_t, page* pg ) {
+    for ( size_t i = 0; i < pg->size(); ++i ) {
+      pg->touch( pg->back_index()[ i ], version, m_track_slots );
+    }
+  } );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+uint64_t sparse_vector< T, PageSize, Policy, Allocator >::version( const size_t pos ) const {
+  const auto pg = get_page( pos / PageSize );
+  return pg ? pg->version( pos % PageSize ) : 0;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::track_slot_versions( const bool enable ) {
+  m_track_slots = enable;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+bool sparse_vector< T, PageSize, Policy, Allocator >::slot_versions_tracked() const {
+  return m_track_slots;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+uint64_t sparse_vector< T, PageSize, Policy, Allocator >::page_version( const size_t page_idx ) const {
+  const auto pg = get_page( page_idx );
+  return pg ? pg->version() : 0;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::mask_words( const size_t first_word, const size_t count, uint64_t* out ) const {
+  for ( size_t i = 0; i < count; ++i ) {
+    const size_t base = ( first_word + i ) * 64;
+    uint64_t result( 0 );
+
+    // a single step if pages are whole words, otherwise a word is
+    // stitched from pieces of several pages
+    for ( size_t bit = 0; bit < 64; ) {
+      const size_t slot = ( base + bit ) % PageSize;
+      const size_t n = std::min( std::min( PageSize - slot, 64 - bit ), 64 - slot % 64 );
+
+      const auto pg = get_page( ( base + bit ) / PageSize );
+      if ( pg ) {
+        result |= ( ( pg->mask( slot / 64 ) >> ( slot % 64 ) ) & low_bits( n ) ) << bit;
+      }
+
+      bit += n;
+    }
+
+    out[ i ] = result;
   }
+}
 
-  return result;
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page_count() const {
+  return m_pages.size();
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::next_page( const size_t page_idx ) const {
+  const size_t result = m_pages.next( page_idx );
+  return result == page_directory_type::npos ? bad_index : result;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T* sparse_vector< T, PageSize, Policy, Allocator >::page_data( const size_t page_idx ) {
+  const auto pg = get_page( page_idx );
+  return pg ? pg->data() : nullptr;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+const typename sparse_vector< T, PageSize, Policy, Allocator >::index_type* sparse_vector< T, PageSize, Policy, Allocator >::page_back_index( const size_t page_idx ) const {
+  const auto pg = get_page( page_idx );
+  return pg ? pg->back_index() : nullptr;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page_group_size( const size_t page_idx ) const {
+  const auto pg = get_page( page_idx );
+  return pg ? pg->group_size() : 0;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::on_inserted( const size_t pos ) {
+  if ( m_size++ == 0 ) {
+    m_min = pos;
+    m_max = pos;
+  } else if ( pos < m_min ) {
+    m_min = pos;
+  } else if ( pos > m_max ) {
+    m_max = pos;
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::on_erased( const size_t pos ) {
+  if ( --m_size == 0 ) {
+    m_min = bad_index;
+    m_max = bad_index;
+    return;
+  }
+
+  if ( pos == m_min ) {
+    m_min = find_next( pos );
+  }
+
+  if ( pos == m_max ) {
+    m_max = find_prev( pos );
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::on_page_filled( const size_t page_idx ) {
+  const page* pg = m_pages.get( page_idx );
+  const size_t base = page_idx * PageSize;
+  const size_t lo = base + pg->next_index( 0 );
+  const size_t hi = base + pg->prev_index( PageSize - 1 );
+
+  m_min = m_size == 0 ? lo : std::min( m_min, lo );
+  m_max = m_size == 0 ? hi : std::max( m_max, hi );
+  m_size += pg->size();
 }
 
-template < typename T, size_t PageSize >
-void sparse_vector< T, PageSize >::clear() {
-  for ( auto& pg : m_pages ) {
-    if ( pg ) {
-      delete pg;
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::find_next( const size_t pos ) const {
+  for ( size_t page_idx = m_pages.next( pos / PageSize ); page_idx < m_pages.size(); page_idx = m_pages.next( page_idx + 1 ) ) {
+    const page* pg = m_pages.get( page_idx );
+    const size_t idx = pg->next_index( page_idx == pos / PageSize ? pos % PageSize : 0 );
+    if ( idx != bad_index ) {
+      return page_idx * PageSize + idx;
     }
   }
 
-  m_pages.swap( std::vector< page* >() );
+  return bad_index;
 }
 
-template < typename T, size_t PageSize >
-void sparse_vector< T, PageSize >::erase_page( const size_t page_idx ) {
-  if ( m_pages[ page_idx ] ) {
-    delete m_pages[ page_idx ];
-    m_pages[ page_idx ] = nullptr;
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::find_prev( const size_t pos ) const {
+  for ( size_t page_idx = m_pages.prev( pos / PageSize ); page_idx != page_directory_type::npos; page_idx = page_idx ? m_pages.prev( page_idx - 1 ) : page_directory_type::npos ) {
+    const page* pg = m_pages.get( page_idx );
+    const size_t idx = pg->prev_index( page_idx == pos / PageSize ? pos % PageSize : PageSize - 1 );
+    if ( idx != bad_index ) {
+      return page_idx * PageSize + idx;
+    }
   }
+
+  return bad_index;
 }
 
-template < typename T, size_t PageSize >
-void sparse_vector< T, PageSize >::reserve( const size_t count ) {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::reserve( const size_t count ) {
   assert( count < bad_index );
 
   size_t pages_count = ( count % PageSize == 0 )
     ? ( count / PageSize )
     : ( count / PageSize + 1 );
 
-  m_pages.resize( pages_count, nullptr );
-
   for ( size_t i = 0; i < pages_count; ++i ) {
-    if ( !m_pages[ i ] ) {
-      m_pages[ i ] = new page();
+    get_or_create_page( i );
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::copy_page( const sparse_vector& other, const size_t src_page, const size_t dst_page ) {
+  assert( &other != this || src_page != dst_page );
+
+  erase_range( dst_page * PageSize, ( dst_page + 1 ) * PageSize );
+
+  const auto src = other.get_page( src_page );
+  if ( !src || src->size() == 0 ) {
+    return;
+  }
+
+  get_or_create_page( dst_page ).assign( *src );
+  on_page_filled( dst_page );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::copy_from( const sparse_vector& other ) {
+  if ( &other == this ) {
+    return;
+  }
+
+  clear();
+  other.m_pages.for_each( [ this, &other ]( const size_t page_idx, const page* ) {
+    copy_page( other, page_idx, page_idx );
+  } );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Out >
+void sparse_vector< T, PageSize, Policy, Allocator >::save( Out& out ) const {
+  static_assert( std::is_trivially_copyable< T >::value, "only trivially copyable elements can be saved" );
+
+  uint64_t counts[ 2 ] = { 0, 0 }; // pages, elements
+  m_pages.for_each( [ &counts ]( const size_t, const page* pg ) {
+    counts[ 0 ] += pg->size() != 0 ? 1 : 0;
+    counts[ 1 ] += pg->size();
+  } );
+  out.write( counts, sizeof( counts ) );
+
+  m_pages.for_each( [ &out ]( const size_t page_idx, const page* pg ) {
+    if ( pg->size() != 0 ) {
+      pg->save( page_idx, out );
     }
+  } );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename In >
+void sparse_vector< T, PageSize, Policy, Allocator >::load( In& in ) {
+  static_assert( std::is_trivially_copyable< T >::value, "only trivially copyable elements can be loaded" );
+
+  clear();
+
+  uint64_t counts[ 2 ]; // pages, elements
+  std::memcpy( counts, in.read( sizeof( counts ) ), sizeof( counts ) );
+
+  // nothing of a rejected image is kept
+  try {
+    uint64_t elements( 0 );
+    for ( uint64_t i = 0; i < counts[ 0 ]; ++i ) {
+      uint64_t header[ 2 ]; // page index, count of elements
+      std::memcpy( header, in.read( sizeof( header ) ), sizeof( header ) );
+
+      const size_t page_idx = static_cast< size_t >( header[ 0 ] );
+      if ( header[ 1 ] == 0 || header[ 1 ] > PageSize || page_idx > bad_index / PageSize || get_page( page_idx ) ) {
+        throw std::runtime_error( "Corrupted page image" );
+      }
+
+      get_or_create_page( page_idx ).load( static_cast< size_t >( header[ 1 ] ), in );
+      on_page_filled( page_idx );
+      elements += header[ 1 ];
+    }
+
+    if ( elements != counts[ 1 ] ) {
+      throw std::runtime_error( "Corrupted page image" );
+    }
+  } catch ( ... ) {
+    clear();
+    throw;
   }
 }
 
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::set_page_pool_capacity( const size_t count ) {
+  m_page_pool_capacity = count;
+
+  while ( m_free_pages.size() > m_page_pool_capacity ) {
+    delete_page( m_free_pages.back() );
+    m_free_pages.pop_back();
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page_pool_capacity() const {
+  return m_page_pool_capacity;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+const page_pool_stats& sparse_vector< T, PageSize, Policy, Allocator >::pool_stats() const {
+  return m_pool_stats;
+}
+
+//=============================================================================
+//
+// sparse_vector::slot_deleter
+//
+//=============================================================================
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+sparse_vector< T, PageSize, Policy, Allocator >::slot_deleter::slot_deleter( const slot_allocator& alloc ):
+  allocator( alloc ) {
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::slot_deleter::operator()( slot_versions* versions ) {
+  slot_allocator_traits::destroy( allocator, versions );
+  slot_allocator_traits::deallocate( allocator, versions, 1 );
+}
+
 //=============================================================================
 //
 // sparse_vector::page
 //
 //=============================================================================
 
-template < typename T, size_t PageSize >
-sparse_vector< T, PageSize >::page::page():
-  m_size( 0 ) {
-  m_index.fill( bad_index );
-  m_back_index.fill( bad_index );
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+sparse_vector< T, PageSize, Policy, Allocator >::page::page( const slot_allocator& alloc ):
+  m_size( 0 ),
+  m_group( 0 ),
+  m_version( 0 ),
+  m_slot_versions( nullptr, slot_deleter( alloc ) ) {
+  m_index.fill( bad_page_index );
+  m_back_index.fill( bad_page_index );
+  m_mask.fill( 0 );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+sparse_vector< T, PageSize, Policy, Allocator >::page::~page() {
+  destroy( 0, m_size, trivially_destructible() );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::clear() {
+  destroy( 0, m_size, trivially_destructible() );
+  for ( size_t i = 0; i < m_size; ++i ) {
+    m_index[ m_back_index[ i ] ] = bad_page_index;
+    m_back_index[ i ] = bad_page_index;
+  }
+
+  m_mask.fill( 0 );
+  m_size = 0;
+  m_group = 0;
+  m_version = 0;
+  m_slot_versions.reset();
 }
 
-template < typename T, size_t PageSize >
-T& sparse_vector< T, PageSize >::page::insert( const size_t pos, const T& arg ) {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T& sparse_vector< T, PageSize, Policy, Allocator >::page::insert( const size_t pos, const T& arg ) {
   assert( pos < PageSize );
 
-  if ( m_index[ pos ] == bad_index ) {
+  if ( !exist( pos ) ) {
     take_place( pos, arg );
   }
 
   return *reinterpret_cast< T* >( m_data + m_index[ pos ] );
 }
 
-template < typename T, size_t PageSize >
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
 template < typename... Args >
-T& sparse_vector< T, PageSize >::page::emplace( const size_t pos, Args&&... args ) {
+T& sparse_vector< T, PageSize, Policy, Allocator >::page::emplace( const size_t pos, Args&&... args ) {
   assert( pos < PageSize );
 
-  if ( m_index[ pos ] == bad_index ) {
+  if ( !exist( pos ) ) {
     take_place( pos, std::forward< Args >( args )... );
   }
 
   return *reinterpret_cast< T* >( m_data + m_index[ pos ] );
 }
 
-template < typename T, size_t PageSize >
-void sparse_vector< T, PageSize >::page::erase( const size_t pos ) {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::erase( const size_t pos ) {
   assert( pos < PageSize );
 
-  if ( m_index[ pos ] == bad_index ) {
+  if ( !exist( pos ) ) {
     return;
   }
 
-  reinterpret_cast< const T* >( m_data + m_index[ pos ] )->~T();
-
-  for ( size_t i = m_index[ pos ] + 1; i < m_size; ++i ) {
-    *reinterpret_cast< T* >( m_data + ( i - 1 ) ) = std::move( *reinterpret_cast< const T* >( m_data + i ) );
-    reinterpret_cast< const T* >( m_data + i )->~T();
-    --m_index[ m_back_index[ i ] ];
-    m_back_index[ i - 1 ] = m_back_index[ i ];
+  // leave the group prefix first, so the gap is closed outside of it
+  if ( in_group( pos ) ) {
+    group_remove( pos );
   }
 
-  m_index[ pos ] = bad_index;
-  m_back_index[ m_size - 1 ] = bad_index;
+  const size_t place = m_index[ pos ];
+  destroy( place, place + 1, trivially_destructible() );
+
+  close_gap( place, Policy() );
+
+  m_index[ pos ] = bad_page_index;
+  m_back_index[ m_size - 1 ] = bad_page_index;
+  m_mask[ pos / 64 ] &= ~( uint64_t( 1 ) << ( pos % 64 ) );
 
   --m_size;
 }
 
-template < typename T, size_t PageSize >
-bool sparse_vector< T, PageSize >::page::exist( const size_t pos ) const noexcept {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+bool sparse_vector< T, PageSize, Policy, Allocator >::page::exist( const size_t pos ) const noexcept {
   assert( pos < PageSize );
-  return m_index[ pos ] != bad_index;
+  return ( m_mask[ pos / 64 ] >> ( pos % 64 ) ) & 1;
 }
 
-template < typename T, size_t PageSize >
-T& sparse_vector< T, PageSize >::page::get_unsafe( const size_t pos ) noexcept {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+uint64_t sparse_vector< T, PageSize, Policy, Allocator >::page::mask( const size_t w ) const noexcept {
+  assert( w < mask_words );
+  return m_mask[ w ];
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T& sparse_vector< T, PageSize, Policy, Allocator >::page::get_unsafe( const size_t pos ) noexcept {
   assert( pos < PageSize );
   return *reinterpret_cast< T* >( m_data + m_index[ pos ] );
 }
 
-template < typename T, size_t PageSize >
-const T& sparse_vector< T, PageSize >::page::get_unsafe( const size_t pos ) const noexcept {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+const T& sparse_vector< T, PageSize, Policy, Allocator >::page::get_unsafe( const size_t pos ) const noexcept {
   assert( pos < PageSize );
   return *reinterpret_cast< const T* >( m_data + m_index[ pos ] );
 }
 
-template < typename T, size_t PageSize >
-T& sparse_vector< T, PageSize >::page::operator[] ( const size_t pos ) {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T& sparse_vector< T, PageSize, Policy, Allocator >::page::operator[] ( const size_t pos ) {
   assert( pos < PageSize );
 
-  if ( m_index[ pos ] == bad_index ) {
+  if ( !exist( pos ) ) {
     take_place( pos, T() );
   }
 
   return *reinterpret_cast< T* >( m_data + m_index[ pos ] );
 }
 
-template < typename T, size_t PageSize >
-size_t sparse_vector< T, PageSize >::page::min_index() const {
-  size_t result = bad_index;
-  for ( size_t i = 0; i < PageSize; ++i ) {
-    if ( m_index[ i ] != bad_index ) {
-      result = i;
-      break;
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page::next_index( const size_t pos ) const {
+  if ( pos >= PageSize ) {
+    return bad_index;
+  }
+
+  size_t w = pos / 64;
+  uint64_t bits = m_mask[ w ] & ( ~uint64_t( 0 ) << ( pos % 64 ) );
+  while ( !bits ) {
+    if ( ++w == mask_words ) {
+      return bad_index;
     }
+
+    bits = m_mask[ w ];
   }
-  
-  return result;
+
+  return w * 64 + count_trailing_zeros( bits );
 }
 
-template < typename T, size_t PageSize >
-size_t sparse_vector< T, PageSize >::page::max_index() const {
-  size_t result = bad_index;
-  for ( size_t i = PageSize; i > 0; --i ) {
-    if ( m_index[ i - 1 ] != bad_index ) {
-      result = i - 1;
-      break;
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page::prev_index( const size_t pos ) const {
+  assert( pos < PageSize );
+
+  size_t w = pos / 64;
+  uint64_t bits = m_mask[ w ] & ( ~uint64_t( 0 ) >> ( 63 - pos % 64 ) );
+  while ( !bits ) {
+    if ( w-- == 0 ) {
+      return bad_index;
     }
+
+    bits = m_mask[ w ];
+  }
+
+  return w * 64 + 63 - count_leading_zeros( bits );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page::rank( const size_t pos ) const {
+  size_t result( 0 );
+  for ( size_t w = 0; w < pos / 64; ++w ) {
+    result += popcount( m_mask[ w ] );
+  }
+
+  if ( pos % 64 ) {
+    result += popcount( m_mask[ pos / 64 ] & ( ~uint64_t( 0 ) >> ( 64 - pos % 64 ) ) );
   }
 
   return result;
 }
 
-template < typename T, size_t PageSize >
-size_t sparse_vector< T, PageSize >::page::size() const {
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page::size() const {
   return m_size;
 }
 
-template < typename T, size_t PageSize >
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::group_add( const size_t pos ) {
+  assert( exist( pos ) && !in_group( pos ) );
+
+  swap_places( m_index[ pos ], m_group );
+  ++m_group;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::group_remove( const size_t pos ) {
+  assert( in_group( pos ) );
+
+  --m_group;
+  swap_places( m_index[ pos ], m_group );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+bool sparse_vector< T, PageSize, Policy, Allocator >::page::in_group( const size_t pos ) const {
+  return exist( pos ) && m_index[ pos ] < m_group;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page::group_size() const {
+  return m_group;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::touch( const size_t pos, const uint64_t version, const bool slot ) {
+  assert( exist( pos ) );
+
+  if ( slot ) {
+    // slots untouched so far are assumed as recent as the page
+    if ( !m_slot_versions ) {
+      slot_allocator& alloc = m_slot_versions.get_deleter().allocator;
+      slot_versions* versions = slot_allocator_traits::allocate( alloc, 1 );
+      slot_allocator_traits::construct( alloc, versions );
+      versions->fill( m_version );
+      m_slot_versions.reset( versions );
+    }
+
+    ( *m_slot_versions )[ pos ] = version;
+  }
+
+  m_version = std::max( m_version, version );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+uint64_t sparse_vector< T, PageSize, Policy, Allocator >::page::version() const {
+  return m_version;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+uint64_t sparse_vector< T, PageSize, Policy, Allocator >::page::version( const size_t pos ) const {
+  return m_slot_versions ? ( *m_slot_versions )[ pos ] : m_version;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page::place( const size_t pos ) const noexcept {
+  assert( exist( pos ) );
+  return m_index[ pos ];
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::reorder( const size_t first, const size_t* order, const size_t count ) {
+  // current[ i ] is the original place of the element now at first + i,
+  // location is the inverse, both relative to first
+  std::vector< size_t > current( count ), location( count );
+  for ( size_t i = 0; i < count; ++i ) {
+    current[ i ] = location[ i ] = i;
+  }
+
+  for ( size_t i = 0; i < count; ++i ) {
+    const size_t wanted = order[ i ] - first;
+    const size_t at = location[ wanted ];
+    if ( at == i ) {
+      continue;
+    }
+
+    swap_places( first + i, first + at );
+    location[ current[ i ] ] = at;
+    current[ at ] = current[ i ];
+    current[ i ] = wanted;
+    location[ wanted ] = i;
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::swap_places( const size_t a, const size_t b ) {
+  if ( a == b ) {
+    return;
+  }
+
+  swap_elements( a, b, trivially_copyable() );
+
+  const index_type pos_a = m_back_index[ a ];
+  const index_type pos_b = m_back_index[ b ];
+  m_back_index[ a ] = pos_b;
+  m_back_index[ b ] = pos_a;
+  m_index[ pos_a ] = static_cast< index_type >( b );
+  m_index[ pos_b ] = static_cast< index_type >( a );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+T* sparse_vector< T, PageSize, Policy, Allocator >::page::data() noexcept {
+  return reinterpret_cast< T* >( m_data );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+const T* sparse_vector< T, PageSize, Policy, Allocator >::page::data() const noexcept {
+  return reinterpret_cast< const T* >( m_data );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+const typename sparse_vector< T, PageSize, Policy, Allocator >::index_type* sparse_vector< T, PageSize, Policy, Allocator >::page::back_index() const noexcept {
+  return m_back_index.data();
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
 template < typename... Args >
-void sparse_vector< T, PageSize >::page::take_place( const size_t pos, Args&&... args ) {
+void sparse_vector< T, PageSize, Policy, Allocator >::page::take_place( const size_t pos, Args&&... args ) {
   assert( pos < PageSize );
-  assert( m_index[ pos ] == bad_index );
+  assert( !exist( pos ) );
+
+  const size_t place = insert_place( pos, Policy() );
+
+  // shift elements
+  relocate( place + 1, place, m_size - place, trivially_copyable() );
+  for ( size_t i = m_size; i > place; --i ) {
+    ++m_index[ m_back_index [ i - 1 ] ];
+    m_back_index[ i ] = m_back_index[ i - 1 ];
+  }
+
+  m_index[ pos ] = static_cast< index_type >( place );
+  m_back_index[ place ] = static_cast< index_type >( pos );
+  m_mask[ pos / 64 ] |= uint64_t( 1 ) << ( pos % 64 );
+
+  new( &m_data[ place ] ) T( std::forward< Args >( args )... );
+  ++m_size;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page::insert_place( const size_t pos, ordered_page_policy ) const {
+  // elements are ordered by index, so the new one goes after all lesser indices
+  return rank( pos );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+size_t sparse_vector< T, PageSize, Policy, Allocator >::page::insert_place( const size_t, unordered_page_policy ) const {
+  return m_size;
+}
 
-  if ( m_size == 0 || m_back_index[ m_size - 1 ] < pos ) {
-    // inserting at end, fast way
-    m_index[ pos ] = m_size;
-    m_back_index[ m_size ] = pos;
-    new( &m_data[ m_size++ ] ) T( std::forward< Args >( args )... );
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::close_gap( const size_t place, ordered_page_policy ) {
+  relocate( place, place + 1, m_size - place - 1, trivially_copyable() );
+  for ( size_t i = place + 1; i < m_size; ++i ) {
+    --m_index[ m_back_index[ i ] ];
+    m_back_index[ i - 1 ] = m_back_index[ i ];
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::close_gap( const size_t place, unordered_page_policy ) {
+  const size_t last = m_size - 1;
+  if ( place == last ) {
+    return;
+  }
+
+  relocate( place, last, 1, trivially_copyable() );
+  m_index[ m_back_index[ last ] ] = static_cast< index_type >( place );
+  m_back_index[ place ] = m_back_index[ last ];
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::relocate( const size_t dst, const size_t src, const size_t count, std::true_type ) {
+  if ( count ) {
+    std::memmove( static_cast< void* >( m_data + dst ), static_cast< const void* >( m_data + src ), count * sizeof( T ) );
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::relocate( const size_t dst, const size_t src, const size_t count, std::false_type ) {
+  const auto move = [ this ]( const size_t to, const size_t from ) {
+    new( &m_data[ to ] ) T( std::move( *reinterpret_cast< T* >( m_data + from ) ) );
+    reinterpret_cast< const T* >( m_data + from )->~T();
+  };
+
+  // walk away from the overlap
+  if ( dst > src ) {
+    for ( size_t i = count; i > 0; --i ) {
+      move( dst + i - 1, src + i - 1 );
+    }
   } else {
-    size_t next = bad_index;
-    for ( size_t i = pos; i < PageSize; ++i ) {
-      if ( m_index[ i ] != bad_index ) {
-        next = i;
-        break;
-      }
+    for ( size_t i = 0; i < count; ++i ) {
+      move( dst + i, src + i );
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::destroy( const size_t, const size_t, std::true_type ) {
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::destroy( const size_t first, const size_t last, std::false_type ) {
+  for ( size_t i = first; i < last; ++i ) {
+    reinterpret_cast< const T* >( m_data + i )->~T();
+  }
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::swap_elements( const size_t a, const size_t b, std::true_type ) {
+  typename std::aligned_storage< sizeof( T ), alignof( T ) >::type tmp;
+  std::memcpy( static_cast< void* >( &tmp ), static_cast< const void* >( m_data + a ), sizeof( T ) );
+  std::memcpy( static_cast< void* >( m_data + a ), static_cast< const void* >( m_data + b ), sizeof( T ) );
+  std::memcpy( static_cast< void* >( m_data + b ), static_cast< const void* >( &tmp ), sizeof( T ) );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::swap_elements( const size_t a, const size_t b, std::false_type ) {
+  T* pa = reinterpret_cast< T* >( m_data + a );
+  T* pb = reinterpret_cast< T* >( m_data + b );
+
+  T tmp( std::move( *pa ) );
+  pa->~T();
+  new( pa ) T( std::move( *pb ) );
+  pb->~T();
+  new( pb ) T( std::move( tmp ) );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::assign( const page& other ) {
+  assert( m_size == 0 );
+
+  copy_elements( other, trivially_copyable() );
+
+  m_index = other.m_index;
+  m_back_index = other.m_back_index;
+  m_mask = other.m_mask;
+  m_size = other.m_size;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename Out >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::save( const size_t page_idx, Out& out ) const {
+  const uint64_t header[ 2 ] = { page_idx, m_size };
+  out.write( header, sizeof( header ) );
+  out.write( m_index.data(), sizeof( m_index ) );
+  out.write( m_back_index.data(), sizeof( m_back_index ) );
+  out.write( m_mask.data(), sizeof( m_mask ) );
+  out.write( m_data, m_size * sizeof( T ) );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+template < typename In >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::load( const size_t count, In& in ) {
+  assert( m_size == 0 );
+
+  // take all parts first, so that a short read leaves the page empty
+  const void* index = in.read( sizeof( m_index ) );
+  const void* back_index = in.read( sizeof( m_back_index ) );
+  const void* mask = in.read( sizeof( m_mask ) );
+  const void* data = in.read( count * sizeof( T ) );
+
+  std::memcpy( m_index.data(), index, sizeof( m_index ) );
+  std::memcpy( m_back_index.data(), back_index, sizeof( m_back_index ) );
+  std::memcpy( m_mask.data(), mask, sizeof( m_mask ) );
+  if ( !consistent( count, Policy() ) ) {
+    m_index.fill( bad_page_index );
+    m_back_index.fill( bad_page_index );
+    m_mask.fill( 0 );
+    throw std::runtime_error( "Corrupted page image" );
+  }
+
+  std::memcpy( static_cast< void* >( m_data ), data, count * sizeof( T ) );
+  m_size = count;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+bool sparse_vector< T, PageSize, Policy, Allocator >::page::consistent( const size_t count, ordered_page_policy ) const {
+  // ordered pages keep places sorted by slot
+  for ( size_t i = 1; i < count; ++i ) {
+    if ( m_back_index[ i - 1 ] >= m_back_index[ i ] ) {
+      return false;
     }
+  }
+
+  return consistent( count, unordered_page_policy() );
+}
 
-    assert( next != bad_index );
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+bool sparse_vector< T, PageSize, Policy, Allocator >::page::consistent( const size_t count, unordered_page_policy ) const {
+  size_t bits( 0 );
+  for ( const auto word : m_mask ) {
+    bits += popcount( word );
+  }
 
-    m_index[ pos ] = m_index[ next ];
+  if ( bits != count ) {
+    return false;
+  }
 
-    // shift elements
-    size_t endIdx = m_index[ next ];
-    for ( size_t i = m_size; i > endIdx; --i ) {
-      *reinterpret_cast< T* >( m_data + i ) = std::move( *reinterpret_cast< const T* >( m_data + ( i - 1 ) ) );
-      reinterpret_cast< const T* >( m_data + ( i - 1 ) )->~T();
-      ++m_index[ m_back_index [ i - 1 ] ];
-      m_back_index[ i ] = m_back_index[ i - 1 ];
+  // every place maps to a distinct occupied slot and back, so with the
+  // count of bits matching, occupied slots are exactly those of back_index
+  for ( size_t i = 0; i < count; ++i ) {
+    const size_t slot = m_back_index[ i ];
+    if ( slot >= PageSize || !exist( slot ) || m_index[ slot ] != i ) {
+      return false;
     }
+  }
+
+  for ( size_t i = count; i < PageSize; ++i ) {
+    if ( m_back_index[ i ] != bad_page_index ) {
+      return false;
+    }
+  }
 
-    m_back_index[ m_index[ pos ] ] = pos;
+  for ( size_t slot = 0; slot < PageSize; ++slot ) {
+    if ( !exist( slot ) && m_index[ slot ] != bad_page_index ) {
+      return false;
+    }
+  }
 
-    new( &m_data[ m_index[ pos ] ] ) T( std::forward< Args >( args )... );
-    ++m_size;
+  return true;
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::copy_elements( const page& other, std::true_type ) {
+  std::memcpy( static_cast< void* >( m_data ), static_cast< const void* >( other.m_data ), other.m_size * sizeof( T ) );
+}
+
+template < typename T, size_t PageSize, typename Policy, typename Allocator >
+void sparse_vector< T, PageSize, Policy, Allocator >::page::copy_elements( const page& other, std::false_type ) {
+  size_t i( 0 );
+  try {
+    for ( ; i < other.m_size; ++i ) {
+      new( &m_data[ i ] ) T( *reinterpret_cast< const T* >( other.m_data + i ) );
+    }
+  } catch ( ... ) {
+    destroy( 0, i, trivially_destructible() );
+    throw;
   }
 }
 
@@ -1,63 +1,173 @@
 #pragma once
 
 #include "types.h"
-#include "type_enumerator.h"
+#include "component_type.h"
+#include "archetype_storage.h"
 #include "sparse_vector.h"
+#include "sparse_set.h"
+#include "soa_vector.h"
+#include "tag_vector.h"
+#include "thread_pool.h"
+#include "query.h"
+#include "group.h"
+#include "component_signal.h"
+#include "memory_resource.h"
+#include "snapshot.h"
 
 #include <type_traits>
 #include <map>
+#include <memory>
 
 namespace ecs {
-  struct component_storages {};
-  struct component_type_base {};
+  // storage layout of a component, specialize component_traits to tune it:
+  //
+  //   template <>
+  //   struct component_traits< Explosion >: default_component_traits< Explosion > {
+  //     static const size_t page_size = 256;
+  //   };
+  //
+  // declaring fields switches the component to structure-of-arrays storage:
+  //
+  //   using fields = soa_fields< soa_field< Position, float, &Position::x >,
+  //                              soa_field< Position, float, &Position::y > >;
+  //
+  // empty components are tags and are kept as occupancy bits, see tag_vector
+  //
+  // storages draw memory from the resource of their components_storage as
+  // long as allocator can be constructed from a memory_resource*
+  //
+  // sparse_set_policy keeps all components of the type in one dense array,
+  // see sparse_set; such components can't be grouped or sorted:
+  //
+  //   using page_policy = sparse_set_policy;
+  template < typename T >
+  struct default_component_traits {
+    static const size_t page_size = 64;
+    using page_policy = ordered_page_policy;
+    using allocator = resource_allocator< T >;
+    using fields = void;
+  };
+
+  template < typename T >
+  struct component_traits: public default_component_traits< T > {};
+
+  template < typename T >
+  struct is_soa_component: public std::integral_constant< bool, !std::is_void< typename component_traits< T >::fields >::value > {};
+
+  template < typename T >
+  struct is_tag_component: public std::integral_constant< bool, std::is_empty< T >::value && !is_soa_component< T >::value > {};
 
-  template < typename >
-  struct component_type: public component_type_base {
-    static const size_t id;
+  template < typename T >
+  struct is_sparse_set_component: public std::integral_constant< bool,
+    std::is_same< typename component_traits< T >::page_policy, sparse_set_policy >::value && !is_soa_component< T >::value && !is_tag_component< T >::value > {};
+
+  template < typename T >
+  struct component_storage_type {
+    using traits = component_traits< T >;
+    using type = typename std::conditional< is_soa_component< T >::value,
+      soa_vector< T, traits::page_size, typename traits::fields, typename traits::allocator >,
+      typename std::conditional< is_tag_component< T >::value,
+        tag_vector< T, traits::page_size, typename traits::allocator >,
+        typename std::conditional< is_sparse_set_component< T >::value,
+          sparse_set< T, traits::page_size, typename traits::allocator >,
+          sparse_vector< T, traits::page_size, typename traits::page_policy, typename traits::allocator > >::type >::type >::type;
   };
 
+  // T& for regular components, void for SoA ones
   template < typename T >
-  const size_t component_type< T >::id = type_collection< component_storages >::type_id< T >();
+  using component_reference = typename component_storage_type< T >::type::reference;
 
-  class components_storage {
-    template < typename... Ts >
-    class join_exclude_wrapper {
-    private:
-      template < class Ft, class... Rs >
-      void join_impl( const eid_t id, Ft&& f, Rs&&... rs );
+  template < typename... Ts >
+  struct same_page_size;
 
-      template < class T, class... TsJoin, class Ft, class... Rs >
-      void join_impl( const eid_t id, Ft&& f, Rs&&... rs );
+  template < typename T >
+  struct same_page_size< T >: public std::true_type {};
 
-      template < class Ft >
-      void exclude_impl( const eid_t id, Ft&& f );
+  template < typename T, typename U, typename... Ts >
+  struct same_page_size< T, U, Ts... >: public std::integral_constant< bool,
+    component_traits< T >::page_size == component_traits< U >::page_size && same_page_size< U, Ts... >::value > {};
 
-      template < class T, class... TsEx, class Ft >
-      void exclude_impl( const eid_t id, Ft&& f );
+  // true if every one of Ts keeps whole objects in slots, that is it is
+  // neither SoA nor a tag
+  template < typename... Ts >
+  struct dense_components;
 
+  template <>
+  struct dense_components<>: public std::true_type {};
+
+  template < typename T, typename... Ts >
+  struct dense_components< T, Ts... >: public std::integral_constant< bool,
+    !is_soa_component< T >::value && !is_tag_component< T >::value && dense_components< Ts... >::value > {};
+
+  // components which can be saved to snapshots: trivially copyable ones
+  // kept in a sparse_vector
+  template < typename T >
+  struct is_snapshot_component: public std::integral_constant< bool,
+    std::is_trivially_copyable< T >::value && dense_components< T >::value && !is_sparse_set_component< T >::value > {};
+
+  enum class storage_backend {
+    sparse,    // a sparse_vector per component type
+    archetype  // entities grouped by component set, see archetype_storage
+  };
+
+  class components_storage {
+    template < typename... >
+    friend class cached_query;
+
+    template < typename... >
+    friend class owning_group;
+
+    template < typename... Ts >
+    class join_exclude_wrapper {
     public:
       join_exclude_wrapper( components_storage& storage );
     
       template < typename... TsEx, typename Ft >
       void exclude( Ft&& func );
 
+      // see parallel_join
+      template < typename... TsEx, typename Ft >
+      void parallel_exclude( Ft&& func );
+
     private:
       components_storage& m_storage;
     };
 
   public:
+    static const size_t default_join_task_pages = 4;
+
+    // storages and their pages, chunks of the archetype backend, id maps
+    // of queries and internal tables are allocated from resource, which
+    // must outlive the components_storage
+    explicit components_storage( const storage_backend backend = storage_backend::sparse, memory_resource* resource = new_delete_resource() );
     ~components_storage();
 
+    components_storage( const components_storage& ) = delete;
+    components_storage& operator= ( const components_storage& ) = delete;
+
     /* modify */
     template < typename T, typename... Ts >
-    T& add_entity_component( const eid_t id, Ts&&... ts );
+    component_reference< T > add_entity_component( const eid_t id, Ts&&... ts );
 
     template < typename T, typename... Ts >
-    T& set_entity_component( const eid_t id, const T& t );
+    component_reference< T > set_entity_component( const eid_t id, const T& t );
 
     template < typename T >
     void remove_entity_component( const eid_t id );
 
+    // bulk versions of add and remove for spawn and despawn bursts,
+    // components are added to ids [ first, first + count ) and removed
+    // from ids [ first, last ), existing components are left intact
+    template < typename T, typename... Ts >
+    void add_entity_component_range( const eid_t first, const size_t count, const Ts&... ts );
+
+    // adds *values++ to every id of [ first, last )
+    template < typename T, typename IdIt, typename ValueIt >
+    void insert_entity_component_range( IdIt first, const IdIt last, ValueIt values );
+
+    template < typename T >
+    void remove_entity_component_range( const eid_t first, const eid_t last );
+
     void remove_all_components( const eid_t id );
 
     /* access */
@@ -67,33 +177,304 @@ namespace ecs {
     template < typename T >
     const T* get_entity_component( const eid_t id ) const;
 
+    // f( id, components... ) for every entity having all of Cs, found by
+    // ANDing occupancy masks of their storages a word of 64 ids at a time;
+    // f may add or remove components of the entity it is called for only
     template < typename... Cs, typename Ft >
     void join( Ft&& func );
 
     template < typename... Ts >
     join_exclude_wrapper< Ts... > join();
 
+    // f( ids, arrays..., n ) for runs of entities having all of Ts, components
+    // of a run lie contiguously in every storage and arrays[ i ] belongs to
+    // ids[ i ]; runs end at page borders and wherever the storages' layouts
+    // diverge, so fully populated pages of the same size come as single runs,
+    // archetype chunks always do; f must not add or remove components
+    template < typename... Ts, typename Ft >
+    void join_batch( Ft&& func );
+
+    // join over entities which T was added, set or written through a
+    // mutable reference after tick since; whole pages of T untouched since
+    // then are skipped, single elements as well when T's storage tracks slot
+    // versions; every component is considered changed on the archetype backend;
+    // SoA components are tracked by page only, for them f is called as by
+    // join_fields for pages of T changed after since
+    template < typename T, typename... Ts, typename Ft >
+    void join_changed( const uint64_t since, Ft&& func );
+
+    // modifications are stamped with the current tick, mutable access is
+    // any of get_entity_component, set_entity_component or a join taking
+    // the component by non-const reference
+    uint64_t tick() const;
+    uint64_t advance_tick();
+
+    // join split into tasks on page boundaries of the joined id range and
+    // run through the join executor, f is called concurrently and must not
+    // add or remove components; falls back to join on the archetype backend
+    template < typename... Ts, typename Ft >
+    void parallel_join( Ft&& func );
+
+    // executor for parallel joins, an empty one selects the built-in thread pool
+    void set_join_executor( join_executor executor );
+
+    // pages per parallel join task
+    void set_join_task_pages( const size_t pages );
+    size_t join_task_pages() const;
+
+    // join of SoA components page by page, f( base_id, mask, fields... ) gets
+    // the AND of occupancy masks and a tuple of per-field arrays for every Ts,
+    // all of them indexed by id - base_id, sparse backend only; pages handed
+    // out as tuples of non-const pointers are stamped with the current tick
+    template < typename... Ts, typename Ft >
+    void join_fields( Ft&& func );
+
+    // cached set of entities having all of Ts, created on the first call
+    // and updated by every add and remove afterwards
+    template < typename... Ts >
+    cached_query< Ts... >& query();
+
+    // group owning storages of Ts, created on the first call, see owning_group;
+    // a storage is owned by one group at most, sparse backend only
+    template < typename... Ts >
+    owning_group< Ts... >& group();
+
+    // hooks of T: on_add fires after T is added to an entity, on_replace
+    // after an existing T is overwritten by set, on_remove before T is
+    // removed, remove_all_components included; adding T to an entity which
+    // has it leaves the component intact and fires nothing, range adds
+    // included; a type without hooks costs one check per modification
+    template < typename T >
+    component_signal& on_add();
+
+    template < typename T >
+    component_signal& on_remove();
+
+    template < typename T >
+    component_signal& on_replace();
+
+    // reorder T within every page by compare( const T&, const T& ), so that
+    // for_each_page and for_each of storage< T >() stream pages in key order;
+    // entities keep their ids, so joins still visit them by id, iteration of an
+    // owning group follows owning_group::sort; needs unordered_page_policy,
+    // sparse backend only
+    template < typename T, typename Compare >
+    void sort( Compare compare );
+
+    // reorder U within every page to follow the order of T, components of
+    // entities having both come first
+    template < typename T, typename U >
+    void sort_as();
+
+    // direct access to the storage of a component type, sparse backend only
+    template < typename T >
+    typename component_storage_type< T >::type& storage();
+
+    memory_resource* resource() const;
+
+    // write components of Ts to a snapshot as raw page images, sparse
+    // backend only, see is_snapshot_component
+    template < typename... Ts >
+    void save( snapshot_writer& out ) const;
+
+    // replace components of Ts with those written by save< Ts... >, pages
+    // are copied as a whole with no per-component work; loaded components
+    // count as modified at the current tick, queries are updated while
+    // hooks don't fire; Ts must not be owned by a group; if load throws,
+    // components of the type being loaded are left removed
+    template < typename... Ts >
+    void load( snapshot_reader& in );
+
   private:
+    struct component_signals {
+      component_signal add;
+      component_signal remove;
+      component_signal replace;
+      bool ( *has )( const components_storage& storage, const eid_t id );
+    };
+
+    using storage_deleter = void ( * )( sparse_vector_base* storage, memory_resource* resource );
+
+    // tables of the storage draw from its resource as well
+    template < typename T >
+    using resource_vector = std::vector< T, resource_allocator< T > >;
+
+    template < typename S >
+    static void delete_storage( sparse_vector_base* storage, memory_resource* resource );
+
+    template < typename T >
+    typename component_storage_type< T >::type* get_storage() const;
+
     template < typename T >
-    sparse_vector< T >* get_storage() const;
+    component_signals& get_or_create_signals();
+
+    // nullptr if no hook of the type was requested
+    component_signals* get_signals( const size_t type ) const;
+
+    // on_add or on_replace depending on whether the component existed
+    void emit_added( const component_signals* signals, const eid_t id, const bool replaced ) const;
+    void emit_removed( const component_signals* signals, const eid_t id ) const;
 
     template < typename T >
-    sparse_vector< T >& get_or_create_storage();
+    typename component_storage_type< T >::type& get_or_create_storage();
+
+    // add and set of the sparse backend, SoA components never take part in queries
+    template < typename T, typename... Ts >
+    T& sparse_add( std::false_type, const eid_t id, Ts&&... ts );
+
+    template < typename T, typename... Ts >
+    void sparse_add( std::true_type, const eid_t id, Ts&&... ts );
 
+    template < typename T >
+    T& set_sparse_component( std::false_type, const eid_t id, const T& t );
+
+    template < typename T >
+    void set_sparse_component( std::true_type, const eid_t id, const T& t );
+
+    template < class T >
+    bool has_components( const eid_t id ) const;
+
+    template < class T, class... Rs >
+    typename std::enable_if< sizeof...( Rs ) != 0, bool >::type has_components( const eid_t id ) const;
+
+    // subscribe observer for changes of types, each type once
+    void add_observer( const size_t idx, std::unique_ptr< storage_observer > observer, const std::vector< size_t >& types );
+
+    // keep queries and groups up to date, removals are notified beforehand
+    void notify_added( const eid_t id, const size_t type );
+    void notify_removed( const eid_t id, const size_t type );
+    void notify_added_range( const eid_t first, const eid_t last, const size_t type );
+    void notify_removed_range( const eid_t first, const eid_t last, const size_t type );
+
+    // returns false if f is not called
     template < class Ft, class... Rs >
-    void join_impl( const eid_t id, Ft&& f, Rs&&... rs );
+    bool join_impl( const eid_t id, Ft&& f, Rs&&... rs );
 
     template < class T, class... Ts, class Ft, class... Rs >
-    void join_impl( const eid_t id, Ft&& f, Rs&&... rs );
+    bool join_impl( const eid_t id, Ft&& f, Rs&&... rs );
+
+    // component without touching it
+    template < typename T >
+    T* find_component( const eid_t id ) const;
+
+    // mark component of id as modified at the current tick
+    template < typename T >
+    void touch( const eid_t id );
+
+    // touch components f takes by non-const reference, f( id, Ts&... )
+    template < class Ft, class... Ts >
+    void touch_written( const eid_t id );
+
+    template < class Ft, class... Ts, size_t... Is >
+    void touch_written( const eid_t id, index_sequence< Is... > );
 
+    template < class Ft, class... Ts, size_t... Is >
+    void touch_all_written( index_sequence< Is... > );
+
+    // touch pages of id of Ts f takes fields of by non-const pointers,
+    // f( base_id, mask, fields... )
+    template < class Ft, class... Ts, size_t... Is >
+    void touch_fields_written( const eid_t id, index_sequence< Is... > );
+
+    // join_changed of SoA and of regular components
+    template < typename T, typename... Ts, typename Ft >
+    void join_changed( const uint64_t since, Ft& f, std::true_type );
+
+    template < typename T, typename... Ts, typename Ft >
+    void join_changed( const uint64_t since, Ft& f, std::false_type );
+
+    // join_fields over all pages or over pages of the first of Ts changed
+    // after since
+    template < typename... Ts, typename Ft >
+    void join_pages( const bool changed, const uint64_t since, Ft& f );
+
+    template < typename T >
+    void touch_all();
+
+    template < typename T >
+    void save_storage( snapshot_writer& out ) const;
+
+    template < typename T >
+    void load_storage( snapshot_reader& in );
+
+    // words of occupancy masks combined at once by joins
+    static const size_t join_mask_block = 8;
+
+    // intersection of index ranges of Ts and the largest of their page sizes,
+    // returns false if any of the storages is missing or the intersection is empty
+    template < class T >
+    bool get_join_range( std::pair< size_t, size_t >& range, size_t& page_size ) const;
+
+    template < class T, class... Rs >
+    typename std::enable_if< sizeof...( Rs ) != 0, bool >::type get_join_range( std::pair< size_t, size_t >& range, size_t& page_size ) const;
+
+    // f( id ) for every id within [ first, last ) having all of Ts and none of TsEx;
+    // occupancy masks of join_mask_block words are ANDed across storages, a block
+    // is dropped as soon as it turns zero and the scan jumps to the next id where
+    // all of Ts have a live page, only set bits are visited
+    template < class... Ts, class... TsEx, class Ft >
+    void for_each_match( type_list< TsEx... >, const size_t first, const size_t last, Ft&& f ) const;
+
+    // mask &= occupancy of every T, returns false if mask turned zero
+    template < class T >
+    bool and_mask( const size_t first_word, const size_t count, uint64_t* mask ) const;
+
+    template < class T, class... Rs >
+    typename std::enable_if< sizeof...( Rs ) != 0, bool >::type and_mask( const size_t first_word, const size_t count, uint64_t* mask ) const;
+
+    // mask &= ~occupancy of T
+    template < class T >
+    void and_not_mask( const size_t first_word, const size_t count, uint64_t* mask ) const;
+
+    // lowest id not less than id lying in a live page of every one of Ts,
+    // found in a single pass over the storages, so it may still miss some
+    // of them; bad_index of size_t if any of them has nothing left
     template < class T >
-    void get_index_range( eid_t& min_index, eid_t& max_index );
+    size_t next_live_id( const size_t id ) const;
 
     template < class T, class... Rs >
-    typename std::enable_if< sizeof...( Rs ) != 0 >::type get_index_range( eid_t& min_index, eid_t& max_index );
+    typename std::enable_if< sizeof...( Rs ) != 0, size_t >::type next_live_id( const size_t id ) const;
+
+    // f( id, components... ) with components of id taken from storages
+    template < class Ft, class Storages, size_t... Is >
+    static void join_call( Ft& f, const eid_t id, const Storages& storages, index_sequence< Is... > );
+
+    // f( ids, bases..., n )
+    template < class Ft, class Bases, size_t... Is >
+    static void batch_call( Ft& f, const std::vector< eid_t >& ids, const Bases& bases, index_sequence< Is... > );
+
+    // components of id follow the run starting at bases, which is n long
+    template < class Storages, class Bases, size_t... Is >
+    static bool continues_run( const Storages& storages, const Bases& bases, const size_t n, const eid_t id, index_sequence< Is... > );
+
+    template < class Storages, class Bases, size_t... Is >
+    static void start_run( const Storages& storages, Bases& bases, const eid_t id, index_sequence< Is... > );
+
+    // join and exclude of the sparse backend, parallel_mask_join splits the
+    // joined id range into tasks of join_task_pages pages run by the executor
+    template < class... Ts, class... TsEx, class Ft >
+    void mask_join( type_list< TsEx... >, Ft& f );
+
+    template < class... Ts, class... TsEx, class Ft >
+    void parallel_mask_join( type_list< TsEx... >, Ft& f );
+
+    void run_join_tasks( const size_t count, const std::function< void( const size_t ) >& task );
 
-    std::vector< sparse_vector_base* > m_componentStorages;
+    memory_resource*                                        m_resource;
+    resource_vector< sparse_vector_base* >                  m_componentStorages;
+    resource_vector< storage_deleter >                      m_storageDeleters;  // by component type id
+    std::unique_ptr< archetype_storage >                    m_archetypes;
+    join_executor                                           m_joinExecutor;
+    std::unique_ptr< thread_pool >                          m_threadPool;
+    size_t                                                  m_joinTaskPages;
+    uint64_t                                                m_tick;
+    resource_vector< std::unique_ptr< storage_observer > >  m_observers;     // by query or group type id
+    resource_vector< resource_vector< storage_observer* > > m_typeObservers; // by component type id
+    resource_vector< bool >                                 m_owned;         // by component type id
+    resource_vector< std::unique_ptr< component_signals > > m_signals;       // by component type id
   };
 }
 
 #include "storage.hpp"
+#include "query.hpp"
+#include "group.hpp"
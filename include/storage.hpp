@@ -1,53 +1,269 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <stdexcept>
 
 namespace ecs {
 
 template < typename T >
-sparse_vector< T >& components_storage::get_or_create_storage() {
+typename component_storage_type< T >::type& components_storage::get_or_create_storage() {
+  using storage_type = typename component_storage_type< T >::type;
   const auto idx = component_type< T >::id;
 
   if ( m_componentStorages.size() <= idx ) {
     m_componentStorages.resize( idx + 1, nullptr );
+    m_storageDeleters.resize( idx + 1, nullptr );
   }
 
   if ( !m_componentStorages[ idx ] ) {
-    m_componentStorages[ idx ] = static_cast< sparse_vector_base* >( new sparse_vector< T >() );
+    void* place = m_resource->allocate( sizeof( storage_type ), alignof( storage_type ) );
+    try {
+      m_componentStorages[ idx ] = static_cast< sparse_vector_base* >( new( place ) storage_type( make_allocator< typename storage_type::allocator_type >( m_resource ) ) );
+    } catch ( ... ) {
+      m_resource->deallocate( place, sizeof( storage_type ), alignof( storage_type ) );
+      throw;
+    }
+
+    m_storageDeleters[ idx ] = &delete_storage< storage_type >;
   }
 
-  return static_cast< sparse_vector< T >& >( *( m_componentStorages[ idx ] ) );
+  return static_cast< storage_type& >( *( m_componentStorages[ idx ] ) );
+}
+
+template < typename S >
+void components_storage::delete_storage( sparse_vector_base* storage, memory_resource* resource ) {
+  S* s = static_cast< S* >( storage );
+  s->~S();
+  resource->deallocate( s, sizeof( S ), alignof( S ) );
 }
 
 template < typename T >
-sparse_vector< T >* components_storage::get_storage() const {
+typename component_storage_type< T >::type* components_storage::get_storage() const {
+  using storage_type = typename component_storage_type< T >::type;
   const auto idx = component_type< T >::id;
 
   if ( m_componentStorages.size() <= idx ) {
     return nullptr;
   }
 
-  return static_cast< sparse_vector< T >* >( m_componentStorages[ idx ] );
+  return static_cast< storage_type* >( m_componentStorages[ idx ] );
+}
+
+template < typename T >
+typename component_storage_type< T >::type& components_storage::storage() {
+  assert( !m_archetypes );
+
+  return get_or_create_storage< T >();
+}
+
+template < typename T, typename... Ts >
+component_reference< T > components_storage::add_entity_component( const eid_t id, Ts&&... args ) {
+  if ( m_archetypes ) {
+    const auto signals = get_signals( component_type< T >::id );
+    const bool existed = signals && m_archetypes->get< T >( id );
+
+    auto& result = m_archetypes->add< T >( id, std::forward< Ts >( args )... );
+    notify_added( id, component_type< T >::id );
+    if ( !existed ) {
+      emit_added( signals, id, false );
+    }
+    return static_cast< component_reference< T > >( result );
+  }
+
+  return sparse_add< T >( is_soa_component< T >(), id, std::forward< Ts >( args )... );
 }
 
 template < typename T, typename... Ts >
-T& components_storage::add_entity_component( const eid_t id, Ts&&... args ) {
+T& components_storage::sparse_add( std::false_type, const eid_t id, Ts&&... args ) {
   auto& storage = get_or_create_storage< T >();
-  return storage.emplace( id, args... );
+  const auto signals = get_signals( component_type< T >::id );
+  const bool existed = signals && storage.exist( id );
+
+  auto& result = storage.emplace( id, std::forward< Ts >( args )... );
+  storage.touch( id, m_tick );
+  notify_added( id, component_type< T >::id );
+  if ( !existed ) {
+    emit_added( signals, id, false );
+  }
+
+  return result;
+}
+
+template < typename T, typename... Ts >
+void components_storage::sparse_add( std::true_type, const eid_t id, Ts&&... args ) {
+  auto& storage = get_or_create_storage< T >();
+  const auto signals = get_signals( component_type< T >::id );
+  const bool existed = signals && storage.exist( id );
+
+  storage.emplace( id, std::forward< Ts >( args )... );
+  storage.touch( id, m_tick );
+  if ( !existed ) {
+    emit_added( signals, id, false );
+  }
 }
 
 template < typename T >
 T* components_storage::get_entity_component( const eid_t id ) {
-  auto& storage = get_or_create_storage< T >();
-  if ( storage.exist( id ) ) {
-    return &storage.get_unsafe( id );
+  static_assert( !is_soa_component< T >::value, "SoA components are accessed through storage< T >()" );
+
+  T* result = find_component< T >( id );
+  if ( result ) {
+    touch< T >( id );
+  }
+
+  return result;
+}
+
+template < typename T >
+T* components_storage::find_component( const eid_t id ) const {
+  if ( m_archetypes ) {
+    return m_archetypes->get< T >( id );
+  }
+
+  const auto storage = get_storage< T >();
+  if ( storage && storage->exist( id ) ) {
+    return &storage->get_unsafe( id );
   }
 
   return nullptr;
 }
 
+template < typename T >
+void components_storage::touch( const eid_t id ) {
+  // the component could be removed by the callback it was written in
+  const auto storage = get_storage< T >();
+  if ( storage && storage->exist( id ) ) {
+    storage->touch( id, m_tick );
+  }
+}
+
+template < class Ft, class... Ts >
+void components_storage::touch_written( const eid_t id ) {
+  touch_written< Ft, Ts... >( id, make_index_sequence< sizeof...( Ts ) >() );
+}
+
+template < class Ft, class... Ts, size_t... Is >
+void components_storage::touch_written( const eid_t id, index_sequence< Is... > ) {
+  // argument 0 is the id
+  using swallow = int[];
+  ( void )swallow{ 0, ( writes_argument< Ft, Is + 1 >::value ? touch< Ts >( id ) : void(), 0 )... };
+}
+
+template < class Ft, class... Ts, size_t... Is >
+void components_storage::touch_fields_written( const eid_t id, index_sequence< Is... > ) {
+  // arguments 0 and 1 are the base id and the mask
+  using swallow = int[];
+  ( void )swallow{ 0, ( writes_argument< Ft, Is + 2 >::value ? touch< Ts >( id ) : void(), 0 )... };
+}
+
+template < class Ft, class... Ts, size_t... Is >
+void components_storage::touch_all_written( index_sequence< Is... > ) {
+  using swallow = int[];
+  ( void )swallow{ 0, ( writes_argument< Ft, Is + 1 >::value ? touch_all< Ts >() : void(), 0 )... };
+}
+
+template < typename T >
+void components_storage::touch_all() {
+  const auto storage = get_storage< T >();
+  if ( storage ) {
+    storage->touch_all( m_tick );
+  }
+}
+
+template < typename... Ts >
+void components_storage::save( snapshot_writer& out ) const {
+  assert( !m_archetypes );
+
+  out.write_value( uint64_t( sizeof...( Ts ) ) );
+
+  using swallow = int[];
+  ( void )swallow{ 0, ( save_storage< Ts >( out ), 0 )... };
+}
+
+template < typename... Ts >
+void components_storage::load( snapshot_reader& in ) {
+  assert( !m_archetypes );
+
+  if ( in.read_value< uint64_t >() != sizeof...( Ts ) ) {
+    throw std::runtime_error( "Snapshot holds another set of components" );
+  }
+
+  using swallow = int[];
+  ( void )swallow{ 0, ( load_storage< Ts >( in ), 0 )... };
+}
+
+template < typename T >
+void components_storage::save_storage( snapshot_writer& out ) const {
+  static_assert( is_snapshot_component< T >::value, "only trivially copyable components kept in sparse_vector can be saved" );
+
+  // layout of T and the page policy, checked on load
+  const bool unordered = std::is_same< typename component_traits< T >::page_policy, unordered_page_policy >::value;
+  const uint64_t header[ 4 ] = { sizeof( T ), alignof( T ), component_traits< T >::page_size, unordered };
+  out.write( header, sizeof( header ) );
+
+  const auto storage = get_storage< T >();
+  if ( storage ) {
+    storage->save( out );
+  } else {
+    out.write_value( uint64_t( 0 ) );
+  }
+}
+
+template < typename T >
+void components_storage::load_storage( snapshot_reader& in ) {
+  static_assert( is_snapshot_component< T >::value, "only trivially copyable components kept in sparse_vector can be loaded" );
+
+  const bool unordered = std::is_same< typename component_traits< T >::page_policy, unordered_page_policy >::value;
+  const uint64_t expected[ 4 ] = { sizeof( T ), alignof( T ), component_traits< T >::page_size, unordered };
+  uint64_t header[ 4 ];
+  std::memcpy( header, in.read( sizeof( header ) ), sizeof( header ) );
+  if ( std::memcmp( header, expected, sizeof( header ) ) != 0 ) {
+    throw std::runtime_error( "Snapshot component layout mismatch" );
+  }
+
+  const size_t type = component_type< T >::id;
+  assert( m_owned.size() <= type || !m_owned[ type ] );
+
+  auto& storage = get_or_create_storage< T >();
+  const bool observed = m_typeObservers.size() > type && !m_typeObservers[ type ].empty();
+  const auto notify = [ this, &storage, type, observed ]( const bool added ) {
+    if ( observed ) {
+      storage.for_each_index( [ this, type, added ]( const size_t id ) {
+        if ( added ) {
+          notify_added( static_cast< eid_t >( id ), type );
+        } else {
+          notify_removed( static_cast< eid_t >( id ), type );
+        }
+      } );
+    }
+  };
+
+  notify( false );
+  try {
+    storage.load( in );
+  } catch ( ... ) {
+    notify( true );
+    throw;
+  }
+
+  storage.touch_all( m_tick );
+  notify( true );
+}
+
 template < typename T >
 const T* components_storage::get_entity_component( const eid_t id ) const {
+  static_assert( !is_soa_component< T >::value, "SoA components are accessed through storage< T >()" );
+
+  if ( m_archetypes ) {
+    return m_archetypes->get< T >( id );
+  }
+
   const auto storage = get_storage< T >();
   if ( storage && storage->exist( id ) ) {
     return &storage->get_unsafe( id );
@@ -57,105 +273,637 @@ const T* components_storage::get_entity_component( const eid_t id ) const {
 }
 
 template < typename T, typename... Ts >
-T& components_storage::set_entity_component( const eid_t id, const T& c ) {
+component_reference< T > components_storage::set_entity_component( const eid_t id, const T& c ) {
+  if ( m_archetypes ) {
+    const auto signals = get_signals( component_type< T >::id );
+    const bool replaced = signals && m_archetypes->get< T >( id );
+
+    auto& result = m_archetypes->set< T >( id, c );
+    notify_added( id, component_type< T >::id );
+    emit_added( signals, id, replaced );
+    return static_cast< component_reference< T > >( result );
+  }
+
+  return set_sparse_component< T >( is_soa_component< T >(), id, c );
+}
+
+template < typename T >
+T& components_storage::set_sparse_component( std::false_type, const eid_t id, const T& c ) {
   auto& storage = get_or_create_storage< T >();
-  return storage[ id ] = c;
+  const auto signals = get_signals( component_type< T >::id );
+  const bool replaced = signals && storage.exist( id );
+
+  auto& result = storage.set( id, c );
+  storage.touch( id, m_tick );
+  notify_added( id, component_type< T >::id );
+  emit_added( signals, id, replaced );
+
+  return result;
 }
 
 template < typename T >
-void components_storage::remove_entity_component( const eid_t id ) {
+void components_storage::set_sparse_component( std::true_type, const eid_t id, const T& c ) {
   auto& storage = get_or_create_storage< T >();
-  storage.erase( id );
+  const auto signals = get_signals( component_type< T >::id );
+  const bool replaced = signals && storage.exist( id );
+
+  storage.set( id, c );
+  storage.touch( id, m_tick );
+  emit_added( signals, id, replaced );
+}
+
+template < typename T >
+void components_storage::remove_entity_component( const eid_t id ) {
+  const auto signals = get_signals( component_type< T >::id );
+  if ( signals && has_components< T >( id ) ) {
+    emit_removed( signals, id );
+  }
+
+  notify_removed( id, component_type< T >::id );
+
+  if ( m_archetypes ) {
+    m_archetypes->remove< T >( id );
+  } else {
+    auto& storage = get_or_create_storage< T >();
+    storage.erase( id );
+  }
+}
+
+template < typename T, typename... Ts >
+void components_storage::add_entity_component_range( const eid_t first, const size_t count, const Ts&... args ) {
+  // existing components are not touched by range adds, so neither are they
+  // reported nor stamped with the current tick
+  const auto signals = get_signals( component_type< T >::id );
+  std::vector< eid_t > added;
+  if ( signals || !m_archetypes ) {
+    for ( size_t i = 0; i < count; ++i ) {
+      if ( !has_components< T >( static_cast< eid_t >( first + i ) ) ) {
+        added.push_back( static_cast< eid_t >( first + i ) );
+      }
+    }
+  }
+
+  if ( m_archetypes ) {
+    for ( size_t i = 0; i < count; ++i ) {
+      m_archetypes->add< T >( static_cast< eid_t >( first + i ), args... );
+    }
+  } else {
+    auto& storage = get_or_create_storage< T >();
+    storage.emplace_range( first, count, args... );
+    for ( const auto id : added ) {
+      storage.touch( id, m_tick );
+    }
+  }
+
+  notify_added_range( first, static_cast< eid_t >( first + count ), component_type< T >::id );
+
+  for ( const auto id : added ) {
+    emit_added( signals, id, false );
+  }
+}
+
+template < typename T, typename IdIt, typename ValueIt >
+void components_storage::insert_entity_component_range( IdIt first, const IdIt last, ValueIt values ) {
+  const auto signals = get_signals( component_type< T >::id );
+  std::vector< eid_t > added;
+  if ( signals || !m_archetypes ) {
+    for ( auto it = first; it != last; ++it ) {
+      if ( !has_components< T >( *it ) ) {
+        added.push_back( *it );
+      }
+    }
+  }
+
+  if ( m_archetypes ) {
+    for ( auto it = first; it != last; ++it, ++values ) {
+      m_archetypes->add< T >( *it, *values );
+    }
+  } else {
+    auto& storage = get_or_create_storage< T >();
+    storage.insert_range( first, last, values );
+    for ( const auto id : added ) {
+      storage.touch( id, m_tick );
+    }
+  }
+
+  for ( ; first != last; ++first ) {
+    notify_added( *first, component_type< T >::id );
+  }
+
+  for ( const auto id : added ) {
+    emit_added( signals, id, false );
+  }
+}
+
+template < typename T >
+void components_storage::remove_entity_component_range( const eid_t first, const eid_t last ) {
+  const auto signals = get_signals( component_type< T >::id );
+  if ( signals && !signals->remove.empty() ) {
+    std::vector< eid_t > removed;
+    if ( m_archetypes ) {
+      for ( eid_t id = first; id < last; ++id ) {
+        if ( m_archetypes->get< T >( id ) ) {
+          removed.push_back( id );
+        }
+      }
+    } else if ( const auto storage = get_storage< T >() ) {
+      storage->for_each_index( first, last, [ &removed ]( const size_t id ) {
+        removed.push_back( static_cast< eid_t >( id ) );
+      } );
+    }
+
+    for ( const auto id : removed ) {
+      emit_removed( signals, id );
+    }
+  }
+
+  notify_removed_range( first, last, component_type< T >::id );
+
+  if ( m_archetypes ) {
+    for ( eid_t id = first; id < last; ++id ) {
+      m_archetypes->remove< T >( id );
+    }
+  } else {
+    const auto storage = get_storage< T >();
+    if ( storage ) {
+      storage->erase_range( first, last );
+    }
+  }
+}
+
+template < typename T, typename Compare >
+void components_storage::sort( Compare compare ) {
+  assert( !m_archetypes );
+  static_assert( !is_sparse_set_component< T >::value, "sparse set components can't be sorted" );
+
+  const auto storage = get_storage< T >();
+  if ( storage ) {
+    storage->sort( compare );
+  }
+}
+
+template < typename T, typename U >
+void components_storage::sort_as() {
+  assert( !m_archetypes );
+  static_assert( component_traits< T >::page_size == component_traits< U >::page_size, "sort_as needs the same page size" );
+  static_assert( !is_sparse_set_component< T >::value && !is_sparse_set_component< U >::value, "sparse set components can't be sorted" );
+
+  const auto storage = get_storage< U >();
+  const auto order = get_storage< T >();
+  if ( storage && order ) {
+    storage->sort_as( *order );
+  }
+}
+
+template < typename T >
+component_signal& components_storage::on_add() {
+  return get_or_create_signals< T >().add;
+}
+
+template < typename T >
+component_signal& components_storage::on_remove() {
+  return get_or_create_signals< T >().remove;
+}
+
+template < typename T >
+component_signal& components_storage::on_replace() {
+  return get_or_create_signals< T >().replace;
+}
+
+template < typename T >
+components_storage::component_signals& components_storage::get_or_create_signals() {
+  const size_t type = component_type< T >::id;
+  if ( m_signals.size() <= type ) {
+    m_signals.resize( type + 1 );
+  }
+
+  if ( !m_signals[ type ] ) {
+    m_signals[ type ].reset( new component_signals() );
+    m_signals[ type ]->has = []( const components_storage& storage, const eid_t id ) {
+      return storage.has_components< T >( id );
+    };
+  }
+
+  return *m_signals[ type ];
+}
+
+template < typename... Ts >
+cached_query< Ts... >& components_storage::query() {
+  const size_t idx = type_collection< storage_observers >::type_id< cached_query< Ts... > >();
+  if ( m_observers.size() <= idx || !m_observers[ idx ] ) {
+    std::unique_ptr< cached_query< Ts... > > q( new cached_query< Ts... >( *this ) );
+    cached_query< Ts... >* raw = q.get();
+
+    add_observer( idx, std::move( q ), { component_type< Ts >::id... } );
+    join< Ts... >( [ raw ]( const eid_t id, const Ts&... ) {
+      raw->on_added( id );
+    } );
+  }
+
+  return static_cast< cached_query< Ts... >& >( *m_observers[ idx ] );
+}
+
+template < typename... Ts >
+owning_group< Ts... >& components_storage::group() {
+  assert( !m_archetypes );
+
+  const size_t idx = type_collection< storage_observers >::type_id< owning_group< Ts... > >();
+  if ( m_observers.size() <= idx || !m_observers[ idx ] ) {
+    const std::vector< size_t > types{ component_type< Ts >::id... };
+    for ( const auto t : types ) {
+      if ( m_owned.size() <= t ) {
+        m_owned.resize( t + 1, false );
+      }
+
+      // storages can't be co-ordered by two groups
+      assert( !m_owned[ t ] );
+      m_owned[ t ] = true;
+    }
+
+    std::unique_ptr< owning_group< Ts... > > g( new owning_group< Ts... >( *this, get_or_create_storage< Ts >()... ) );
+    owning_group< Ts... >* raw = g.get();
+
+    add_observer( idx, std::move( g ), types );
+    join< Ts... >( [ raw ]( const eid_t id, const Ts&... ) {
+      raw->on_added( id );
+    } );
+  }
+
+  return static_cast< owning_group< Ts... >& >( *m_observers[ idx ] );
+}
+
+template < class T >
+bool components_storage::has_components( const eid_t id ) const {
+  if ( m_archetypes ) {
+    return m_archetypes->get< T >( id ) != nullptr;
+  }
+
+  const auto storage = get_storage< T >();
+  return storage && storage->exist( id );
+}
+
+template < class T, class... Rs >
+typename std::enable_if< sizeof...( Rs ) != 0, bool >::type components_storage::has_components( const eid_t id ) const {
+  return has_components< T >( id ) && has_components< Rs... >( id );
 }
 
 template < class Ft, class... Rs >
-void components_storage::join_impl( const eid_t id, Ft&& f, Rs&&... rs ) {
+bool components_storage::join_impl( const eid_t id, Ft&& f, Rs&&... rs ) {
   f( id, rs... );
+  return true;
 }
 
 template < class T, class... Ts, class Ft, class... Rs >
-void components_storage::join_impl( const eid_t id, Ft&& f, Rs&&... rs ) {
+bool components_storage::join_impl( const eid_t id, Ft&& f, Rs&&... rs ) {
+  static_assert( !is_soa_component< T >::value, "SoA components are joined with join_fields" );
+
   const auto storage = get_storage< T >();
   if ( !storage || !storage->exist( id ) ) {
-    return;
+    return false;
   }
 
-  join_impl < Ts... >( id, std::forward< Ft >( f ), std::forward< Rs >( rs )..., storage->get_unsafe( id ) );
+  return join_impl < Ts... >( id, std::forward< Ft >( f ), std::forward< Rs >( rs )..., storage->get_unsafe( id ) );
 }
 
 template < typename... Ts, typename Ft >
 void components_storage::join( Ft&& f ) {
-  eid_t min_index( std::numeric_limits< eid_t >::max() ), max_index( 0 );
-  get_index_range< Ts... >( min_index, max_index );
+  if ( m_archetypes ) {
+    m_archetypes->join< Ts... >( type_list<>(), std::forward< Ft >( f ) );
+    return;
+  }
+
+  mask_join< Ts... >( type_list<>(), f );
+}
+
+template < typename... Ts, typename Ft >
+void components_storage::join_batch( Ft&& f ) {
+  static_assert( dense_components< Ts... >::value, "SoA and tag components can't be joined in batches" );
+
+  if ( m_archetypes ) {
+    m_archetypes->join_batch< Ts... >( type_list<>(), f );
+    return;
+  }
+
+  auto range = std::make_pair( size_t( 0 ), std::numeric_limits< size_t >::max() );
+  size_t page_size( 0 );
+  if ( !get_join_range< Ts... >( range, page_size ) ) {
+    return;
+  }
+
+  touch_all_written< Ft, Ts... >( make_index_sequence< sizeof...( Ts ) >() );
+
+  const auto storages = std::make_tuple( get_storage< Ts >()... );
+  std::tuple< Ts*... > bases;
+  std::vector< eid_t > ids;
+  ids.reserve( page_size );
+
+  for_each_match< Ts... >( type_list<>(), range.first, range.second + 1, [ & ]( const size_t id ) {
+    const auto eid = static_cast< eid_t >( id );
+    if ( !ids.empty() && ( ids.size() == page_size || !continues_run( storages, bases, ids.size(), eid, make_index_sequence< sizeof...( Ts ) >() ) ) ) {
+      batch_call( f, ids, bases, make_index_sequence< sizeof...( Ts ) >() );
+      ids.clear();
+    }
+
+    if ( ids.empty() ) {
+      start_run( storages, bases, eid, make_index_sequence< sizeof...( Ts ) >() );
+    }
+
+    ids.push_back( eid );
+  } );
+
+  if ( !ids.empty() ) {
+    batch_call( f, ids, bases, make_index_sequence< sizeof...( Ts ) >() );
+  }
+}
+
+template < class Ft, class Bases, size_t... Is >
+void components_storage::batch_call( Ft& f, const std::vector< eid_t >& ids, const Bases& bases, index_sequence< Is... > ) {
+  f( ids.data(), std::get< Is >( bases )..., ids.size() );
+}
+
+template < class Storages, class Bases, size_t... Is >
+bool components_storage::continues_run( const Storages& storages, const Bases& bases, const size_t n, const eid_t id, index_sequence< Is... > ) {
+  const bool follows[] = { &std::get< Is >( storages )->get_unsafe( id ) == std::get< Is >( bases ) + n... };
+  return std::all_of( std::begin( follows ), std::end( follows ), []( const bool b ) { return b; } );
+}
+
+template < class Storages, class Bases, size_t... Is >
+void components_storage::start_run( const Storages& storages, Bases& bases, const eid_t id, index_sequence< Is... > ) {
+  bases = Bases( &std::get< Is >( storages )->get_unsafe( id )... );
+}
+
+template < typename T, typename... Ts, typename Ft >
+void components_storage::join_changed( const uint64_t since, Ft&& f ) {
+  join_changed< T, Ts... >( since, f, is_soa_component< T >() );
+}
 
-  if ( min_index == std::numeric_limits< eid_t >::max() ) {
+template < typename T, typename... Ts, typename Ft >
+void components_storage::join_changed( const uint64_t since, Ft& f, std::true_type ) {
+  join_pages< T, Ts... >( true, since, f );
+}
+
+template < typename T, typename... Ts, typename Ft >
+void components_storage::join_changed( const uint64_t since, Ft& f, std::false_type ) {
+  if ( m_archetypes ) {
+    join< T, Ts... >( f );
     return;
   }
 
-  for ( eid_t i = min_index; i <= max_index; ++i ) {
-    join_impl< Ts... >( i, std::forward< Ft >( f ) );
+  const auto storage = get_storage< T >();
+  if ( !storage ) {
+    return;
+  }
+
+  using storage_type = typename component_storage_type< T >::type;
+  const size_t page_size = component_traits< T >::page_size;
+  for ( size_t page_idx = storage->next_page( 0 ); page_idx != storage_type::bad_index; page_idx = storage->next_page( page_idx + 1 ) ) {
+    if ( storage->page_version( page_idx ) <= since ) {
+      continue;
+    }
+
+    storage->for_each_index( page_idx * page_size, ( page_idx + 1 ) * page_size, [ this, storage, since, &f ]( const size_t id ) {
+      if ( storage->version( id ) > since && join_impl< T, Ts... >( static_cast< eid_t >( id ), f ) ) {
+        touch_written< Ft, T, Ts... >( static_cast< eid_t >( id ) );
+      }
+    } );
   }
 }
 
 template < class T >
-void components_storage::get_index_range( eid_t& min_index, eid_t& max_index ) {
+bool components_storage::get_join_range( std::pair< size_t, size_t >& range, size_t& page_size ) const {
   const auto storage = get_storage< T >();
-  if ( storage ) {
-    const auto range = storage->index_range();
-    min_index = min_index > range.first ? range.first : min_index;
-    max_index = max_index < range.second ? range.second : max_index;
+  if ( !storage || storage->size() == 0 ) {
+    return false;
   }
+
+  const auto r = storage->index_range();
+  range.first = std::max( range.first, r.first );
+  range.second = std::min( range.second, r.second );
+  const size_t storage_page_size = component_traits< T >::page_size;
+  page_size = std::max( page_size, storage_page_size );
+
+  return range.first <= range.second;
 }
 
 template < class T, class... Rs >
-typename std::enable_if< sizeof...( Rs ) != 0 >::type components_storage::get_index_range( eid_t& min_index, eid_t& max_index ) {
-  const auto storage = get_storage< T >();
-  if ( storage ) {
-    const auto range = storage->index_range();
-    min_index = min_index > range.first ? range.first : min_index;
-    max_index = max_index < range.second ? range.second : max_index;
+typename std::enable_if< sizeof...( Rs ) != 0, bool >::type components_storage::get_join_range( std::pair< size_t, size_t >& range, size_t& page_size ) const {
+  return get_join_range< T >( range, page_size ) && get_join_range< Rs... >( range, page_size );
+}
+
+template < class... Ts, class... TsEx, class Ft >
+void components_storage::for_each_match( type_list< TsEx... >, const size_t first, const size_t last, Ft&& f ) const {
+  uint64_t mask[ join_mask_block ];
+
+  for ( size_t w = first / 64; w * 64 < last; ) {
+    const size_t count = std::min< size_t >( ( last - 1 ) / 64 + 1 - w, size_t( join_mask_block ) );
+    std::fill( mask, mask + count, ~uint64_t( 0 ) );
+    if ( !and_mask< Ts... >( w, count, mask ) ) {
+      // skip the gap where any of Ts has no pages
+      const size_t next = next_live_id< Ts... >( ( w + count ) * 64 );
+      if ( next >= last ) {
+        return;
+      }
+
+      w = next / 64;
+      continue;
+    }
+
+    using swallow = int[];
+    ( void )swallow{ 0, ( and_not_mask< TsEx >( w, count, mask ), 0 )... };
+
+    // f could change occupancy of the entity it is called for only,
+    // so bits collected beforehand stay valid for the rest of them
+    for ( size_t i = 0; i < count; ++i ) {
+      uint64_t bits = mask[ i ] & word_range_bits( w + i, first, last );
+      while ( bits ) {
+        const size_t bit = count_trailing_zeros( bits );
+        bits &= bits - 1;
+        f( ( w + i ) * 64 + bit );
+      }
+    }
+
+    w += count;
   }
+}
 
-  get_index_range< Rs... >( min_index, max_index );
+template < class T >
+bool components_storage::and_mask( const size_t first_word, const size_t count, uint64_t* mask ) const {
+  static_assert( !is_soa_component< T >::value, "SoA components are joined with join_fields" );
+
+  uint64_t words[ join_mask_block ];
+  get_storage< T >()->mask_words( first_word, count, words );
+
+  uint64_t any( 0 );
+  for ( size_t i = 0; i < count; ++i ) {
+    mask[ i ] &= words[ i ];
+    any |= mask[ i ];
+  }
+
+  return any != 0;
 }
 
-template < typename... Ts >
-components_storage::join_exclude_wrapper< Ts... > components_storage::join() {
-  return components_storage::join_exclude_wrapper< Ts... >( *this );
+template < class T, class... Rs >
+typename std::enable_if< sizeof...( Rs ) != 0, bool >::type components_storage::and_mask( const size_t first_word, const size_t count, uint64_t* mask ) const {
+  return and_mask< T >( first_word, count, mask ) && and_mask< Rs... >( first_word, count, mask );
 }
 
-template < typename... Ts >
-template < class Ft, class... Rs >
-void components_storage::join_exclude_wrapper< Ts... >::join_impl( const eid_t id, Ft&& f, Rs&&... rs ) {
-  f( id, rs... );
+template < class T >
+size_t components_storage::next_live_id( const size_t id ) const {
+  const size_t page_size = component_traits< T >::page_size;
+  const size_t page_idx = get_storage< T >()->next_page( id / page_size );
+  if ( page_idx == std::numeric_limits< size_t >::max() ) {
+    return page_idx;
+  }
+
+  return std::max( id, page_idx * page_size );
 }
 
-template < typename... Ts >
-template < class T, class... TsJoin, class Ft, class... Rs >
-void components_storage::join_exclude_wrapper< Ts... >::join_impl( const eid_t id, Ft&& f, Rs&&... rs ) {
-  const auto storage = m_storage.get_storage< T >();
-  if ( !storage || !storage->exist( id ) ) {
+template < class T, class... Rs >
+typename std::enable_if< sizeof...( Rs ) != 0, size_t >::type components_storage::next_live_id( const size_t id ) const {
+  const size_t result = next_live_id< T >( id );
+  return result == std::numeric_limits< size_t >::max() ? result : next_live_id< Rs... >( result );
+}
+
+template < class T >
+void components_storage::and_not_mask( const size_t first_word, const size_t count, uint64_t* mask ) const {
+  const auto storage = get_storage< T >();
+  if ( !storage || storage->size() == 0 ) {
     return;
   }
 
-  join_impl < TsJoin... >( id, std::forward< Ft >( f ), std::forward< Rs >( rs )..., storage->get_unsafe( id ) );
+  uint64_t words[ join_mask_block ];
+  storage->mask_words( first_word, count, words );
+
+  for ( size_t i = 0; i < count; ++i ) {
+    mask[ i ] &= ~words[ i ];
+  }
 }
 
-template < typename... Ts >
-template < class Ft >
-void components_storage::join_exclude_wrapper< Ts... >::exclude_impl( const eid_t id, Ft&& f ) {
-  join_impl < Ts... >( id, std::forward< Ft >( f ) );
+template < class Ft, class Storages, size_t... Is >
+void components_storage::join_call( Ft& f, const eid_t id, const Storages& storages, index_sequence< Is... > ) {
+  f( id, std::get< Is >( storages )->get_unsafe( id )... );
 }
 
-template < typename... Ts >
-template < class T, class... TsEx, class Ft >
-void components_storage::join_exclude_wrapper< Ts... >::exclude_impl( const eid_t id, Ft&& f ) {
-  const auto storage = m_storage.get_storage< T >();
-  if ( storage && storage->exist( id ) ) {
+template < class... Ts, class... TsEx, class Ft >
+void components_storage::mask_join( type_list< TsEx... > excluded, Ft& f ) {
+  auto range = std::make_pair( size_t( 0 ), std::numeric_limits< size_t >::max() );
+  size_t page_size( 0 );
+  if ( !get_join_range< Ts... >( range, page_size ) ) {
+    return;
+  }
+
+  const auto storages = std::make_tuple( get_storage< Ts >()... );
+  for_each_match< Ts... >( excluded, range.first, range.second + 1, [ this, &f, &storages ]( const size_t id ) {
+    join_call( f, static_cast< eid_t >( id ), storages, make_index_sequence< sizeof...( Ts ) >() );
+    touch_written< Ft, Ts... >( static_cast< eid_t >( id ) );
+  } );
+}
+
+template < class... Ts, class... TsEx, class Ft >
+void components_storage::parallel_mask_join( type_list< TsEx... > excluded, Ft& f ) {
+  auto range = std::make_pair( size_t( 0 ), std::numeric_limits< size_t >::max() );
+  size_t page_size( 0 );
+  if ( !get_join_range< Ts... >( range, page_size ) ) {
     return;
   }
 
-  exclude_impl < TsEx... >( id, std::forward< Ft >( f ) );
+  // pages may be shared by tasks, so written storages are touched up front
+  touch_all_written< Ft, Ts... >( make_index_sequence< sizeof...( Ts ) >() );
+
+  // tasks start on page boundaries, so no page is shared between them
+  // unless pages are smaller than a mask word, which is only read; tasks
+  // are made for windows where all of Ts have live pages only
+  const size_t task_ids = page_size * m_joinTaskPages;
+  std::vector< size_t > windows;
+  for ( size_t id = next_live_id< Ts... >( range.first ); id <= range.second; id = next_live_id< Ts... >( ( id / task_ids + 1 ) * task_ids ) ) {
+    windows.push_back( id / task_ids );
+  }
+
+  if ( windows.empty() ) {
+    return;
+  }
+
+  const auto storages = std::make_tuple( get_storage< Ts >()... );
+  run_join_tasks( windows.size(), [ this, excluded, task_ids, &windows, &range, &f, &storages ]( const size_t task ) {
+    const size_t begin = std::max( windows[ task ] * task_ids, range.first );
+    const size_t end = std::min( ( windows[ task ] + 1 ) * task_ids, range.second + 1 );
+    for_each_match< Ts... >( excluded, begin, end, [ &f, &storages ]( const size_t id ) {
+      join_call( f, static_cast< eid_t >( id ), storages, make_index_sequence< sizeof...( Ts ) >() );
+    } );
+  } );
+}
+
+template < typename... Ts, typename Ft >
+void components_storage::parallel_join( Ft&& f ) {
+  if ( m_archetypes ) {
+    join< Ts... >( std::forward< Ft >( f ) );
+    return;
+  }
+
+  parallel_mask_join< Ts... >( type_list<>(), f );
+}
+
+template < typename... Ts, typename Ft >
+void components_storage::join_fields( Ft&& f ) {
+  join_pages< Ts... >( false, 0, f );
+}
+
+template < typename... Ts, typename Ft >
+void components_storage::join_pages( const bool changed, const uint64_t since, Ft& f ) {
+  assert( !m_archetypes );
+  static_assert( same_page_size< Ts... >::value, "joined SoA components must have the same page size" );
+
+  const sparse_vector_base* storages[] = { get_storage< Ts >()... };
+  for ( const auto s : storages ) {
+    if ( !s ) {
+      return;
+    }
+  }
+
+  using first_type = typename std::tuple_element< 0, std::tuple< Ts... > >::type;
+  using first_storage = typename component_storage_type< first_type >::type;
+  const size_t page_size = component_traits< first_type >::page_size;
+
+  // pages missing from any of Ts are skipped without looking at them
+  for ( size_t id = next_live_id< Ts... >( 0 ); id != std::numeric_limits< size_t >::max(); id = next_live_id< Ts... >( ( id / page_size + 1 ) * page_size ) ) {
+    const size_t page_idx = id / page_size;
+    if ( changed && get_storage< first_type >()->page_version( page_idx ) <= since ) {
+      continue;
+    }
+
+    const uint64_t* masks[] = { get_storage< Ts >()->page_mask( page_idx )... };
+
+    std::array< uint64_t, first_storage::mask_words > mask;
+    mask.fill( ~uint64_t( 0 ) );
+
+    uint64_t any( 0 );
+    for ( size_t w = 0; w < mask.size(); ++w ) {
+      for ( const auto m : masks ) {
+        mask[ w ] &= m ? m[ w ] : 0;
+      }
+
+      any |= mask[ w ];
+    }
+
+    if ( !any ) {
+      continue;
+    }
+
+    f( static_cast< eid_t >( page_idx * page_size ), mask.data(), get_storage< Ts >()->page_data( page_idx )... );
+
+    // page versions are stamped through any element of the page
+    size_t w( 0 );
+    while ( !mask[ w ] ) {
+      ++w;
+    }
+
+    touch_fields_written< Ft, Ts... >( static_cast< eid_t >( page_idx * page_size + w * 64 + count_trailing_zeros( mask[ w ] ) ), make_index_sequence< sizeof...( Ts ) >() );
+  }
+}
+
+template < typename... Ts >
+components_storage::join_exclude_wrapper< Ts... > components_storage::join() {
+  return components_storage::join_exclude_wrapper< Ts... >( *this );
 }
 
 template < typename... Ts >
@@ -166,12 +914,23 @@ components_storage::join_exclude_wrapper< Ts... >::join_exclude_wrapper( compone
 template < typename... Ts >
 template < typename... TsEx, typename Ft >
 void components_storage::join_exclude_wrapper< Ts... >::exclude( Ft&& func ) {
-  eid_t min_index( std::numeric_limits< eid_t >::max() ), max_index( 0 );
-  m_storage.get_index_range< Ts... >( min_index, max_index );
+  if ( m_storage.m_archetypes ) {
+    m_storage.m_archetypes->join< Ts... >( type_list< TsEx... >(), std::forward< Ft >( func ) );
+    return;
+  }
+
+  m_storage.mask_join< Ts... >( type_list< TsEx... >(), func );
+}
 
-  for ( eid_t i = min_index; i <= max_index; ++i ) {
-    exclude_impl< TsEx... >( i, std::forward< Ft >( func ) );
+template < typename... Ts >
+template < typename... TsEx, typename Ft >
+void components_storage::join_exclude_wrapper< Ts... >::parallel_exclude( Ft&& func ) {
+  if ( m_storage.m_archetypes ) {
+    exclude< TsEx... >( std::forward< Ft >( func ) );
+    return;
   }
+
+  m_storage.parallel_mask_join< Ts... >( type_list< TsEx... >(), func );
 }
 
 }
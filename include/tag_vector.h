@@ -0,0 +1,145 @@
+#pragma once
+
+#include "sparse_vector.h"
+#include "page_directory.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace ecs {
+
+constexpr size_t greatest_common_divisor( const size_t a, const size_t b ) {
+  return b == 0 ? a : greatest_common_divisor( b, a % b );
+}
+
+// storage of an empty component type, only occupancy is kept: a bit per
+// index packed into 64 bit words, words are grouped into blocks of about
+// 4096 indices with a summary bit per word telling if any of its bits is
+// set; blocks are kept in a page_directory and exist only while they hold
+// an element, so a tag costs a bit instead of a page slot, memory follows
+// the number of live blocks rather than the highest index and scans skip
+// absent blocks and words at once; all elements share a single T
+template < typename T, size_t PageSize = 64, typename Allocator = std::allocator< T > >
+class tag_vector: public sparse_vector_base {
+public:
+  using allocator_type = Allocator;
+  using reference = T&;
+
+  static_assert( std::is_empty< T >::value, "tag_vector is meant for empty types" );
+
+  static const size_t bad_index;
+
+  explicit tag_vector( const Allocator& alloc = Allocator() );
+  ~tag_vector();
+
+  tag_vector( const tag_vector& ) = delete;
+  tag_vector& operator= ( const tag_vector& ) = delete;
+
+  // modify
+  void clear();
+
+  T& insert( const size_t pos, const T& arg );
+
+  // args are only checked to construct a T
+  template < typename... Args >
+  T& emplace( const size_t pos, Args&&... args );
+
+  T& set( const size_t pos, const T& arg );
+
+  void erase( const size_t pos ) override;
+
+  // same as sparse_vector ones, a word is filled or cleared at once
+  template < typename... Args >
+  void emplace_range( const size_t first, const size_t count, const Args&... args );
+
+  template < typename IdIt, typename ValueIt >
+  void insert_range( IdIt first, const IdIt last, ValueIt value );
+
+  void erase_range( const size_t first, const size_t last );
+
+  // access
+  bool exist( const size_t pos ) const noexcept;
+
+  size_t size() const;
+
+  T& get_unsafe( const size_t pos ) noexcept;
+  const T& get_unsafe( const size_t pos ) const noexcept;
+
+  // lowest and highest existing indices, bad_index if empty,
+  // found through the summary words
+  std::pair< size_t, size_t > index_range() const;
+
+  // iterate over indices of existing elements in ascending order,
+  // f is allowed to modify the vector
+  template < typename Ft >
+  void for_each_index( Ft&& f ) const;
+
+  // same for indices within [ first, last )
+  template < typename Ft >
+  void for_each_index( const size_t first, const size_t last, Ft&& f ) const;
+
+  // page level change tracking of PageSize indices, see sparse_vector::touch;
+  // versions are kept by existing blocks only, page_count is one past the
+  // highest page of a block ever used
+  void touch( const size_t pos, const uint64_t version );
+  void touch_all( const uint64_t version );
+  uint64_t version( const size_t pos ) const;
+  uint64_t page_version( const size_t page_idx ) const;
+  size_t page_count() const;
+
+  // first page not less than page_idx lying in an existing block, such
+  // a page may be empty; bad_index if there is none
+  size_t next_page( const size_t page_idx ) const;
+
+  // occupancy of indices [ first_word * 64, ( first_word + count ) * 64 ),
+  // bit i of out[ j ] tells if the element at ( first_word + j ) * 64 + i exists
+  void mask_words( const size_t first_word, const size_t count, uint64_t* out ) const;
+
+private:
+  // blocks hold whole words and whole pages, about 4096 indices
+  static const size_t block_unit = 64 / greatest_common_divisor( 64, PageSize ) * PageSize;
+  static const size_t block_size = block_unit < 4096 ? 4096 / block_unit * block_unit : block_unit;
+  static const size_t block_words = block_size / 64;
+  static const size_t block_pages = block_size / PageSize;
+  static const size_t summary_words = ( block_words + 63 ) / 64;
+
+  struct block {
+    std::array< uint64_t, block_words >   words;    // bit i of word w is the element at w * 64 + i of the block
+    std::array< uint64_t, summary_words > summary;  // bit i of summary word s is set if word s * 64 + i is not 0
+    std::array< uint64_t, block_pages >   versions; // by page
+    size_t                                count;    // of set bits
+  };
+
+  using block_allocator = typename std::allocator_traits< Allocator >::template rebind_alloc< block >;
+  using block_allocator_traits = std::allocator_traits< block_allocator >;
+  using block_directory = page_directory< block, typename std::allocator_traits< Allocator >::template rebind_alloc< block* > >;
+
+  block& get_or_create_block( const size_t block_idx );
+
+  // free the block if it holds nothing
+  void release_block( const size_t block_idx );
+
+  // first word not less than w having a bit set, block_words if none
+  static size_t next_word( const block& blk, const size_t w );
+
+  // set bits of word w of the block, returns how many of them were clear
+  static size_t fill( block& blk, const size_t w, const uint64_t bits );
+  static size_t drain( block& blk, const size_t w, const uint64_t bits );
+
+  block_allocator m_allocator;
+  block_directory m_blocks;
+  size_t          m_size;
+  T               m_value;
+};
+
+template < typename T, size_t PageSize, typename Allocator >
+const size_t tag_vector< T, PageSize, Allocator >::bad_index = std::numeric_limits< size_t >::max();
+
+}
+
+#include "tag_vector.hpp"
@@ -0,0 +1,334 @@
+#pragma once
+
+#include "bits.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ecs {
+
+//=============================================================================
+//
+// tag_vector
+//
+//=============================================================================
+template < typename T, size_t PageSize, typename Allocator >
+tag_vector< T, PageSize, Allocator >::tag_vector( const Allocator& alloc ):
+  m_allocator( alloc ),
+  m_blocks( alloc ),
+  m_size( 0 ),
+  m_value() {
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+tag_vector< T, PageSize, Allocator >::~tag_vector() {
+  clear();
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void tag_vector< T, PageSize, Allocator >::clear() {
+  m_blocks.for_each( [ this ]( const size_t, block* blk ) {
+    block_allocator_traits::destroy( m_allocator, blk );
+    block_allocator_traits::deallocate( m_allocator, blk, 1 );
+  } );
+
+  m_blocks.clear();
+  m_size = 0;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+T& tag_vector< T, PageSize, Allocator >::insert( const size_t pos, const T& ) {
+  assert( pos < bad_index );
+
+  auto& blk = get_or_create_block( pos / block_size );
+  m_size += fill( blk, pos % block_size / 64, uint64_t( 1 ) << ( pos % 64 ) );
+
+  return m_value;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename... Args >
+T& tag_vector< T, PageSize, Allocator >::emplace( const size_t pos, Args&&... args ) {
+  return insert( pos, T( std::forward< Args >( args )... ) );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+T& tag_vector< T, PageSize, Allocator >::set( const size_t pos, const T& arg ) {
+  return insert( pos, arg );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void tag_vector< T, PageSize, Allocator >::erase( const size_t pos ) {
+  assert( pos < bad_index );
+
+  const size_t block_idx = pos / block_size;
+  block* blk = m_blocks.get( block_idx );
+  if ( blk ) {
+    m_size -= drain( *blk, pos % block_size / 64, uint64_t( 1 ) << ( pos % 64 ) );
+    release_block( block_idx );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename... Args >
+void tag_vector< T, PageSize, Allocator >::emplace_range( const size_t first, const size_t count, const Args&... args ) {
+  assert( count < bad_index - first );
+
+  if ( count == 0 ) {
+    return;
+  }
+
+  ( void )T( args... );
+
+  const size_t last = first + count;
+  for ( size_t block_idx = first / block_size; block_idx * block_size < last; ++block_idx ) {
+    auto& blk = get_or_create_block( block_idx );
+    const size_t base = block_idx * block_size;
+    for ( size_t w = first > base ? ( first - base ) / 64 : 0; w < block_words && base + w * 64 < last; ++w ) {
+      m_size += fill( blk, w, word_range_bits( base / 64 + w, first, last ) );
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename IdIt, typename ValueIt >
+void tag_vector< T, PageSize, Allocator >::insert_range( IdIt first, const IdIt last, ValueIt value ) {
+  for ( ; first != last; ++first, ++value ) {
+    insert( *first, *value );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void tag_vector< T, PageSize, Allocator >::erase_range( const size_t first, const size_t last ) {
+  if ( first >= last ) {
+    return;
+  }
+
+  for ( size_t block_idx = m_blocks.next( first / block_size ); block_idx != block_directory::npos && block_idx * block_size < last; block_idx = m_blocks.next( block_idx + 1 ) ) {
+    block& blk = *m_blocks.get( block_idx );
+    const size_t base = block_idx * block_size;
+    for ( size_t w = first > base ? ( first - base ) / 64 : 0; w < block_words && base + w * 64 < last; ++w ) {
+      m_size -= drain( blk, w, word_range_bits( base / 64 + w, first, last ) );
+    }
+
+    release_block( block_idx );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+bool tag_vector< T, PageSize, Allocator >::exist( const size_t pos ) const noexcept {
+  assert( pos < bad_index );
+
+  const block* blk = m_blocks.get( pos / block_size );
+  return blk && ( blk->words[ pos % block_size / 64 ] >> ( pos % 64 ) ) & 1;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t tag_vector< T, PageSize, Allocator >::size() const {
+  return m_size;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+T& tag_vector< T, PageSize, Allocator >::get_unsafe( const size_t ) noexcept {
+  return m_value;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+const T& tag_vector< T, PageSize, Allocator >::get_unsafe( const size_t ) const noexcept {
+  return m_value;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+std::pair< size_t, size_t > tag_vector< T, PageSize, Allocator >::index_range() const {
+  auto result = std::make_pair( bad_index, bad_index );
+  if ( m_size == 0 ) {
+    return result;
+  }
+
+  // existing blocks are never empty
+  const size_t lo = m_blocks.next( 0 );
+  const block& first = *m_blocks.get( lo );
+  const size_t w = next_word( first, 0 );
+  result.first = lo * block_size + w * 64 + count_trailing_zeros( first.words[ w ] );
+
+  const size_t hi = m_blocks.prev( block_directory::npos );
+  const block& last = *m_blocks.get( hi );
+  for ( size_t s = summary_words; s > 0; --s ) {
+    if ( last.summary[ s - 1 ] ) {
+      const size_t lw = ( s - 1 ) * 64 + 63 - count_leading_zeros( last.summary[ s - 1 ] );
+      result.second = hi * block_size + lw * 64 + 63 - count_leading_zeros( last.words[ lw ] );
+      break;
+    }
+  }
+
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename Ft >
+void tag_vector< T, PageSize, Allocator >::for_each_index( Ft&& f ) const {
+  for_each_index( 0, bad_index, std::forward< Ft >( f ) );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+template < typename Ft >
+void tag_vector< T, PageSize, Allocator >::for_each_index( const size_t first, const size_t last, Ft&& f ) const {
+  // blocks and words are looked up again on every step since f could modify them
+  for ( size_t block_idx = m_blocks.next( first / block_size ); block_idx != block_directory::npos && block_idx * block_size < last; block_idx = m_blocks.next( block_idx + 1 ) ) {
+    size_t w = block_idx == first / block_size ? first % block_size / 64 : 0;
+    uint64_t visited( 0 );
+    while ( const block* blk = m_blocks.get( block_idx ) ) {
+      const uint64_t bits = blk->words[ w ] & ~visited;
+      if ( !bits ) {
+        w = next_word( *blk, w + 1 );
+        visited = 0;
+        if ( w == block_words ) {
+          break;
+        }
+
+        continue;
+      }
+
+      const size_t bit = count_trailing_zeros( bits );
+      visited |= ( uint64_t( 2 ) << bit ) - 1;
+
+      // indices ascend, nothing is left past last
+      const size_t pos = block_idx * block_size + w * 64 + bit;
+      if ( pos >= last ) {
+        return;
+      }
+
+      if ( pos >= first ) {
+        f( pos );
+      }
+    }
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void tag_vector< T, PageSize, Allocator >::touch( const size_t pos, const uint64_t version ) {
+  assert( exist( pos ) );
+
+  auto& v = m_blocks.get( pos / block_size )->versions[ pos % block_size / PageSize ];
+  v = std::max( v, version );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void tag_vector< T, PageSize, Allocator >::touch_all( const uint64_t version ) {
+  m_blocks.for_each( [ version ]( const size_t, block* blk ) {
+    for ( auto& v : blk->versions ) {
+      v = std::max( v, version );
+    }
+  } );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+uint64_t tag_vector< T, PageSize, Allocator >::version( const size_t pos ) const {
+  return page_version( pos / PageSize );
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+uint64_t tag_vector< T, PageSize, Allocator >::page_version( const size_t page_idx ) const {
+  const block* blk = m_blocks.get( page_idx / block_pages );
+  return blk ? blk->versions[ page_idx % block_pages ] : 0;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t tag_vector< T, PageSize, Allocator >::page_count() const {
+  return m_blocks.size() * block_pages;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t tag_vector< T, PageSize, Allocator >::next_page( const size_t page_idx ) const {
+  const size_t block_idx = m_blocks.next( page_idx / block_pages );
+  if ( block_idx == block_directory::npos ) {
+    return bad_index;
+  }
+
+  return block_idx == page_idx / block_pages ? page_idx : block_idx * block_pages;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void tag_vector< T, PageSize, Allocator >::mask_words( const size_t first_word, const size_t count, uint64_t* out ) const {
+  for ( size_t i = 0; i < count; ) {
+    const size_t w = first_word + i;
+    const size_t n = std::min( count - i, size_t( block_words ) - w % block_words );
+    const block* blk = m_blocks.get( w / block_words );
+    if ( blk ) {
+      std::copy( blk->words.begin() + w % block_words, blk->words.begin() + w % block_words + n, out + i );
+    } else {
+      std::fill( out + i, out + i + n, uint64_t( 0 ) );
+    }
+
+    i += n;
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+typename tag_vector< T, PageSize, Allocator >::block& tag_vector< T, PageSize, Allocator >::get_or_create_block( const size_t block_idx ) {
+  block* blk = m_blocks.get( block_idx );
+  if ( !blk ) {
+    // value initialized, so words, summary and versions start zeroed
+    blk = block_allocator_traits::allocate( m_allocator, 1 );
+    block_allocator_traits::construct( m_allocator, blk );
+    try {
+      m_blocks.set( block_idx, blk );
+    } catch ( ... ) {
+      block_allocator_traits::destroy( m_allocator, blk );
+      block_allocator_traits::deallocate( m_allocator, blk, 1 );
+      throw;
+    }
+  }
+
+  return *blk;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+void tag_vector< T, PageSize, Allocator >::release_block( const size_t block_idx ) {
+  block* blk = m_blocks.get( block_idx );
+  if ( blk && blk->count == 0 ) {
+    m_blocks.release( block_idx );
+    block_allocator_traits::destroy( m_allocator, blk );
+    block_allocator_traits::deallocate( m_allocator, blk, 1 );
+  }
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t tag_vector< T, PageSize, Allocator >::next_word( const block& blk, const size_t w ) {
+  for ( size_t s = w / 64; s < summary_words; ++s ) {
+    const uint64_t words = s == w / 64 ? blk.summary[ s ] & ~low_bits( w % 64 ) : blk.summary[ s ];
+    if ( words ) {
+      return s * 64 + count_trailing_zeros( words );
+    }
+  }
+
+  return block_words;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t tag_vector< T, PageSize, Allocator >::fill( block& blk, const size_t w, const uint64_t bits ) {
+  const uint64_t added = bits & ~blk.words[ w ];
+  blk.words[ w ] |= bits;
+  if ( blk.words[ w ] ) {
+    blk.summary[ w / 64 ] |= uint64_t( 1 ) << ( w % 64 );
+  }
+
+  const size_t result = popcount( added );
+  blk.count += result;
+  return result;
+}
+
+template < typename T, size_t PageSize, typename Allocator >
+size_t tag_vector< T, PageSize, Allocator >::drain( block& blk, const size_t w, const uint64_t bits ) {
+  const uint64_t removed = bits & blk.words[ w ];
+  blk.words[ w ] &= ~bits;
+  if ( !blk.words[ w ] ) {
+    blk.summary[ w / 64 ] &= ~( uint64_t( 1 ) << ( w % 64 ) );
+  }
+
+  const size_t result = popcount( removed );
+  blk.count -= result;
+  return result;
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ecs {
+
+  // runs task( 0 ) .. task( count - 1 ), possibly concurrently,
+  // and returns when all of them are done
+  using join_executor = std::function< void( const size_t count, const std::function< void( const size_t ) >& task ) >;
+
+  // fixed set of worker threads, the thread calling run takes part in the work,
+  // the first exception thrown by a task is rethrown from run
+  class thread_pool {
+  public:
+    explicit thread_pool( const size_t threads = std::thread::hardware_concurrency() );
+    ~thread_pool();
+
+    thread_pool( const thread_pool& ) = delete;
+    thread_pool& operator= ( const thread_pool& ) = delete;
+
+    // not reentrant, tasks must not call run of the same pool
+    void run( const size_t count, const std::function< void( const size_t ) >& task );
+
+    // including the calling thread
+    size_t thread_count() const;
+
+  private:
+    void worker();
+
+    // takes tasks until there is none left, m_mutex is held on entry and exit
+    void work( std::unique_lock< std::mutex >& lock );
+
+    std::vector< std::thread >                   m_threads;
+    std::mutex                                   m_run;
+    std::mutex                                   m_mutex;
+    std::condition_variable                      m_wake;
+    std::condition_variable                      m_done;
+    const std::function< void( const size_t ) >* m_task;
+    size_t                                       m_count;
+    size_t                                       m_next;
+    size_t                                       m_pending;
+    std::exception_ptr                           m_error;
+    bool                                         m_stop;
+  };
+}
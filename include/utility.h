@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+namespace ecs {
+
+template < typename... Ts >
+struct type_list {};
+
+template < size_t... Is >
+struct index_sequence {};
+
+template < size_t N, size_t... Is >
+struct make_index_sequence: make_index_sequence< N - 1, N - 1, Is... > {};
+
+template < size_t... Is >
+struct make_index_sequence< 0, Is... >: index_sequence< Is... > {};
+
+template < typename... >
+struct make_void {
+  using type = void;
+};
+
+template < typename List, size_t I >
+struct type_at;
+
+template < typename T, typename... Ts >
+struct type_at< type_list< T, Ts... >, 0 > {
+  using type = T;
+};
+
+template < typename T, typename... Ts, size_t I >
+struct type_at< type_list< T, Ts... >, I >: type_at< type_list< Ts... >, I - 1 > {};
+
+// argument types of a function pointer or of a callable with a single
+// non-template operator(), void if they can't be deduced
+template < typename Ft, typename = void >
+struct callable_arguments {
+  using type = void;
+};
+
+template < typename R, typename... Args >
+struct callable_arguments< R ( * )( Args... ), void > {
+  using type = type_list< Args... >;
+};
+
+template < typename Mf >
+struct member_arguments;
+
+template < typename R, typename C, typename... Args >
+struct member_arguments< R ( C::* )( Args... ) > {
+  using type = type_list< Args... >;
+};
+
+template < typename R, typename C, typename... Args >
+struct member_arguments< R ( C::* )( Args... ) const > {
+  using type = type_list< Args... >;
+};
+
+template < typename Ft >
+struct callable_arguments< Ft, typename make_void< decltype( &Ft::operator() ) >::type >: member_arguments< decltype( &Ft::operator() ) > {};
+
+// true if any of Ps is a pointer to non-const, for tuples of pointers
+// as taken by join_fields callbacks
+template < typename T >
+struct is_mutable_tuple: std::false_type {};
+
+template < typename P, typename... Ps >
+struct is_mutable_tuple< std::tuple< P, Ps... > >: std::integral_constant< bool,
+  ( std::is_pointer< P >::value && !std::is_const< typename std::remove_pointer< P >::type >::value ) || is_mutable_tuple< std::tuple< Ps... > >::value > {};
+
+// true if a parameter of type A allows writing to the argument
+template < typename A >
+struct is_mutable_parameter: std::integral_constant< bool,
+  ( std::is_lvalue_reference< A >::value && !std::is_const< typename std::remove_reference< A >::type >::value ) ||
+  ( std::is_pointer< A >::value && !std::is_const< typename std::remove_pointer< A >::type >::value ) ||
+  is_mutable_tuple< typename std::decay< A >::type >::value > {};
+
+// true if Ft may write through its I-th argument, that is the argument is
+// a non-const lvalue reference or pointer, or the arguments can't be deduced
+template < typename Ft, size_t I, typename Args = typename callable_arguments< typename std::decay< Ft >::type >::type >
+struct writes_argument: is_mutable_parameter< typename type_at< Args, I >::type > {};
+
+template < typename Ft, size_t I >
+struct writes_argument< Ft, I, void >: std::true_type {};
+
+}
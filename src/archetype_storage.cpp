@@ -0,0 +1,222 @@
+#include "archetype_storage.h"
+
+#include <algorithm>
+
+namespace ecs {
+
+//=============================================================================
+//
+// archetype_storage::archetype
+//
+//=============================================================================
+bool archetype_storage::archetype::has( const size_t type ) const {
+  return type < column_of.size() && column_of[ type ] != 0;
+}
+
+size_t archetype_storage::archetype::row_count() const {
+  return chunks.empty() ? 0 : ( chunks.size() - 1 ) * capacity + chunks.back()->size;
+}
+
+void* archetype_storage::archetype::data( chunk& ch, const size_t column, const size_t row ) const {
+  return static_cast< unsigned char* >( ch.data ) + offsets[ column ] + row * columns[ column ]->size;
+}
+
+//=============================================================================
+//
+// archetype_storage
+//
+//=============================================================================
+archetype_storage::archetype_storage( memory_resource* resource ):
+  m_resource( resource ),
+  m_locations( resource ) {
+}
+
+archetype_storage::~archetype_storage() {
+  for ( auto& arch : m_archetypes ) {
+    for ( auto& ch : arch->chunks ) {
+      for ( size_t row = 0; row < ch->size; ++row ) {
+        for ( size_t c = 0; c < arch->columns.size(); ++c ) {
+          arch->columns[ c ]->destroy( arch->data( *ch, c, row ) );
+        }
+      }
+
+      free_chunk( *arch, *ch );
+    }
+  }
+}
+
+void archetype_storage::remove_all( const eid_t id ) {
+  if ( find( id ) ) {
+    migrate( id, nullptr );
+  }
+}
+
+size_t archetype_storage::archetype_count() const {
+  return m_archetypes.size();
+}
+
+const archetype_storage::location* archetype_storage::find( const eid_t id ) const {
+  if ( m_locations.size() <= id || !m_locations[ id ].arch ) {
+    return nullptr;
+  }
+
+  return &m_locations[ id ];
+}
+
+archetype_storage::archetype* archetype_storage::find_or_create( const std::vector< size_t >& types ) {
+  const auto it = m_archetypeIndex.find( types );
+  if ( it != m_archetypeIndex.end() ) {
+    return it->second;
+  }
+
+  std::unique_ptr< archetype > arch( new archetype() );
+  arch->types = types;
+  arch->column_of.resize( types.back() + 1, 0 );
+
+  size_t row_size = sizeof( eid_t );
+  arch->chunk_align = alignof( eid_t );
+  for ( size_t c = 0; c < types.size(); ++c ) {
+    arch->columns.push_back( m_columns[ types[ c ] ] );
+    arch->column_of[ types[ c ] ] = c + 1;
+    row_size += arch->columns.back()->size;
+    arch->chunk_align = std::max( arch->chunk_align, arch->columns.back()->align );
+  }
+
+  arch->capacity = std::max< size_t >( 1, chunk_bytes / row_size );
+
+  // ids go first, then every column aligned to its type
+  size_t offset = arch->capacity * sizeof( eid_t );
+  for ( const auto info : arch->columns ) {
+    offset = ( offset + info->align - 1 ) / info->align * info->align;
+    arch->offsets.push_back( offset );
+    offset += arch->capacity * info->size;
+  }
+
+  arch->chunk_size = offset;
+
+  archetype* result = arch.get();
+  m_archetypes.push_back( std::move( arch ) );
+  m_archetypeIndex.emplace( types, result );
+
+  return result;
+}
+
+archetype_storage::archetype* archetype_storage::with( archetype* arch, const size_t type ) {
+  if ( !arch ) {
+    return find_or_create( std::vector< size_t >{ type } );
+  }
+
+  const auto it = arch->add_edges.find( type );
+  if ( it != arch->add_edges.end() ) {
+    return it->second;
+  }
+
+  auto types = arch->types;
+  types.insert( std::lower_bound( types.begin(), types.end(), type ), type );
+
+  archetype* result = find_or_create( types );
+  arch->add_edges.emplace( type, result );
+
+  return result;
+}
+
+archetype_storage::archetype* archetype_storage::without( archetype* arch, const size_t type ) {
+  const auto it = arch->remove_edges.find( type );
+  if ( it != arch->remove_edges.end() ) {
+    return it->second;
+  }
+
+  auto types = arch->types;
+  types.erase( std::lower_bound( types.begin(), types.end(), type ) );
+
+  archetype* result = types.empty() ? nullptr : find_or_create( types );
+  arch->remove_edges.emplace( type, result );
+
+  return result;
+}
+
+void archetype_storage::register_column( const size_t type, const column_info& info ) {
+  if ( m_columns.size() <= type ) {
+    m_columns.resize( type + 1, nullptr );
+  }
+
+  m_columns[ type ] = &info;
+}
+
+archetype_storage::location archetype_storage::allocate_row( archetype& arch, const eid_t id ) {
+  if ( arch.chunks.empty() || arch.chunks.back()->size == arch.capacity ) {
+    std::unique_ptr< chunk > ch( new chunk() );
+    ch->data = m_resource->allocate( arch.chunk_size, arch.chunk_align );
+    ch->ids = static_cast< eid_t* >( ch->data );
+    ch->size = 0;
+    try {
+      arch.chunks.push_back( std::move( ch ) );
+    } catch ( ... ) {
+      free_chunk( arch, *ch );
+      throw;
+    }
+  }
+
+  chunk& ch = *arch.chunks.back();
+  ch.ids[ ch.size ] = id;
+
+  return location{ &arch, arch.chunks.size() - 1, ch.size++ };
+}
+
+void archetype_storage::migrate( const eid_t id, const location* dst ) {
+  if ( m_locations.size() <= id ) {
+    m_locations.resize( id + 1, location{ nullptr, 0, 0 } );
+  }
+
+  const location src = m_locations[ id ];
+  if ( src.arch ) {
+    archetype& from = *src.arch;
+    chunk& ch = *from.chunks[ src.chunk ];
+    for ( size_t c = 0; c < from.columns.size(); ++c ) {
+      void* p = from.data( ch, c, src.row );
+      const size_t type = from.types[ c ];
+      if ( dst && dst->arch->has( type ) ) {
+        archetype& to = *dst->arch;
+        from.columns[ c ]->move_construct( to.data( *to.chunks[ dst->chunk ], to.column_of[ type ] - 1, dst->row ), p );
+      }
+
+      from.columns[ c ]->destroy( p );
+    }
+
+    release_row( src );
+  }
+
+  m_locations[ id ] = dst ? *dst : location{ nullptr, 0, 0 };
+}
+
+void archetype_storage::release_row( const location& loc ) {
+  archetype& arch = *loc.arch;
+  chunk& last = *arch.chunks.back();
+  const size_t last_chunk = arch.chunks.size() - 1;
+  const size_t last_row = last.size - 1;
+
+  if ( loc.chunk != last_chunk || loc.row != last_row ) {
+    chunk& ch = *arch.chunks[ loc.chunk ];
+    for ( size_t c = 0; c < arch.columns.size(); ++c ) {
+      void* p = arch.data( last, c, last_row );
+      arch.columns[ c ]->move_construct( arch.data( ch, c, loc.row ), p );
+      arch.columns[ c ]->destroy( p );
+    }
+
+    const eid_t moved = last.ids[ last_row ];
+    ch.ids[ loc.row ] = moved;
+    m_locations[ moved ] = loc;
+  }
+
+  if ( --last.size == 0 ) {
+    free_chunk( arch, last );
+    arch.chunks.pop_back();
+  }
+}
+
+void archetype_storage::free_chunk( const archetype& arch, chunk& ch ) {
+  m_resource->deallocate( ch.data, arch.chunk_size, arch.chunk_align );
+  ch.data = nullptr;
+}
+
+}
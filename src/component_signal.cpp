@@ -0,0 +1,37 @@
+#include "component_signal.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace ecs {
+
+component_signal::component_signal():
+  m_next( 0 ) {
+}
+
+size_t component_signal::connect( callback f ) {
+  m_slots.push_back( slot{ m_next, std::move( f ) } );
+  return m_next++;
+}
+
+void component_signal::disconnect( const size_t connection ) {
+  const auto it = std::find_if( m_slots.begin(), m_slots.end(), [ connection ]( const slot& s ) {
+    return s.connection == connection;
+  } );
+
+  if ( it != m_slots.end() ) {
+    m_slots.erase( it );
+  }
+}
+
+bool component_signal::empty() const {
+  return m_slots.empty();
+}
+
+void component_signal::emit( const eid_t id ) const {
+  for ( const auto& s : m_slots ) {
+    s.f( id );
+  }
+}
+
+}
@@ -1,16 +1,55 @@
 #include "storage.h"
 
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
 namespace ecs {
 
+components_storage::components_storage( const storage_backend backend, memory_resource* resource ):
+  m_resource( resource ),
+  m_componentStorages( resource ),
+  m_storageDeleters( resource ),
+  m_joinTaskPages( default_join_task_pages ),
+  m_tick( 1 ),
+  m_observers( resource ),
+  m_typeObservers( resource ),
+  m_owned( resource ),
+  m_signals( resource ) {
+  if ( backend == storage_backend::archetype ) {
+    m_archetypes.reset( new archetype_storage( resource ) );
+  }
+}
+
 components_storage::~components_storage() {
-  for ( auto s : m_componentStorages ) {
-    if ( s ) {
-      delete s;
+  for ( size_t i = 0; i < m_componentStorages.size(); ++i ) {
+    if ( m_componentStorages[ i ] ) {
+      m_storageDeleters[ i ]( m_componentStorages[ i ], m_resource );
     }
   }
 }
 
+memory_resource* components_storage::resource() const {
+  return m_resource;
+}
+
 void components_storage::remove_all_components( const eid_t id ) {
+  for ( const auto& s : m_signals ) {
+    if ( s && !s->remove.empty() && s->has( *this, id ) ) {
+      s->remove.emit( id );
+    }
+  }
+
+  for ( const auto& o : m_observers ) {
+    if ( o ) {
+      o->on_removed( id );
+    }
+  }
+
+  if ( m_archetypes ) {
+    m_archetypes->remove_all( id );
+  }
+
   for ( const auto s : m_componentStorages ) {
     if ( s ) {
       s->erase( id );
@@ -18,4 +57,113 @@ void components_storage::remove_all_components( const eid_t id ) {
   }
 }
 
+uint64_t components_storage::tick() const {
+  return m_tick;
+}
+
+uint64_t components_storage::advance_tick() {
+  return ++m_tick;
+}
+
+void components_storage::set_join_executor( join_executor executor ) {
+  m_joinExecutor = std::move( executor );
+}
+
+void components_storage::set_join_task_pages( const size_t pages ) {
+  assert( pages != 0 );
+  m_joinTaskPages = pages;
+}
+
+size_t components_storage::join_task_pages() const {
+  return m_joinTaskPages;
+}
+
+void components_storage::run_join_tasks( const size_t count, const std::function< void( const size_t ) >& task ) {
+  if ( count == 1 ) {
+    task( 0 );
+    return;
+  }
+
+  if ( m_joinExecutor ) {
+    m_joinExecutor( count, task );
+    return;
+  }
+
+  if ( !m_threadPool ) {
+    m_threadPool.reset( new thread_pool() );
+  }
+
+  m_threadPool->run( count, task );
+}
+
+components_storage::component_signals* components_storage::get_signals( const size_t type ) const {
+  return m_signals.size() > type ? m_signals[ type ].get() : nullptr;
+}
+
+void components_storage::emit_added( const component_signals* signals, const eid_t id, const bool replaced ) const {
+  if ( signals ) {
+    ( replaced ? signals->replace : signals->add ).emit( id );
+  }
+}
+
+void components_storage::emit_removed( const component_signals* signals, const eid_t id ) const {
+  if ( signals ) {
+    signals->remove.emit( id );
+  }
+}
+
+void components_storage::add_observer( const size_t idx, std::unique_ptr< storage_observer > observer, const std::vector< size_t >& types ) {
+  if ( m_observers.size() <= idx ) {
+    m_observers.resize( idx + 1 );
+  }
+
+  for ( size_t i = 0; i < types.size(); ++i ) {
+    if ( std::find( types.begin(), types.begin() + i, types[ i ] ) != types.begin() + i ) {
+      continue;
+    }
+
+    if ( m_typeObservers.size() <= types[ i ] ) {
+      m_typeObservers.resize( types[ i ] + 1, resource_vector< storage_observer* >( m_resource ) );
+    }
+
+    m_typeObservers[ types[ i ] ].push_back( observer.get() );
+  }
+
+  m_observers[ idx ] = std::move( observer );
+}
+
+void components_storage::notify_added( const eid_t id, const size_t type ) {
+  if ( m_typeObservers.size() > type ) {
+    for ( const auto o : m_typeObservers[ type ] ) {
+      o->on_added( id );
+    }
+  }
+}
+
+void components_storage::notify_removed( const eid_t id, const size_t type ) {
+  if ( m_typeObservers.size() > type ) {
+    for ( const auto o : m_typeObservers[ type ] ) {
+      o->on_removed( id );
+    }
+  }
+}
+
+void components_storage::notify_added_range( const eid_t first, const eid_t last, const size_t type ) {
+  if ( m_typeObservers.size() > type ) {
+    for ( const auto o : m_typeObservers[ type ] ) {
+      for ( eid_t id = first; id < last; ++id ) {
+        o->on_added( id );
+      }
+    }
+  }
+}
+
+void components_storage::notify_removed_range( const eid_t first, const eid_t last, const size_t type ) {
+  if ( m_typeObservers.size() > type ) {
+    for ( const auto o : m_typeObservers[ type ] ) {
+      o->on_removed_range( first, last );
+    }
+  }
+}
+
 }
@@ -0,0 +1,242 @@
+#include "memory_resource.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace ecs {
+
+namespace {
+
+class new_delete_memory_resource: public memory_resource {
+protected:
+  void* do_allocate( const size_t bytes, const size_t alignment ) override {
+    if ( alignment <= alignof( std::max_align_t ) ) {
+      return ::operator new( bytes );
+    }
+
+    if ( alignment & ( alignment - 1 ) || bytes > std::numeric_limits< size_t >::max() - alignment - sizeof( void* ) ) {
+      throw std::bad_alloc();
+    }
+
+    // over-aligned blocks are cut from a larger one, which address is
+    // kept right before the block
+    void* raw = ::operator new( bytes + alignment + sizeof( void* ) );
+    const uintptr_t aligned = ( reinterpret_cast< uintptr_t >( raw ) + sizeof( void* ) + alignment - 1 ) & ~uintptr_t( alignment - 1 );
+    void* result = reinterpret_cast< void* >( aligned );
+    static_cast< void** >( result )[ -1 ] = raw;
+
+    return result;
+  }
+
+  void do_deallocate( void* p, const size_t, const size_t alignment ) override {
+    ::operator delete( alignment <= alignof( std::max_align_t ) ? p : static_cast< void** >( p )[ -1 ] );
+  }
+};
+
+// headers of chunks are followed by the memory handed out
+size_t chunk_header_size( const size_t header ) {
+  return ( header + alignof( std::max_align_t ) - 1 ) / alignof( std::max_align_t ) * alignof( std::max_align_t );
+}
+
+}
+
+//=============================================================================
+//
+// memory_resource
+//
+//=============================================================================
+void* memory_resource::allocate( const size_t bytes, const size_t alignment ) {
+  return do_allocate( bytes, alignment );
+}
+
+void memory_resource::deallocate( void* p, const size_t bytes, const size_t alignment ) {
+  do_deallocate( p, bytes, alignment );
+}
+
+memory_resource* new_delete_resource() noexcept {
+  static new_delete_memory_resource resource;
+  return &resource;
+}
+
+//=============================================================================
+//
+// monotonic_resource
+//
+//=============================================================================
+monotonic_resource::monotonic_resource( memory_resource* upstream, const size_t chunk_size ):
+  m_upstream( upstream ),
+  m_chunks( nullptr ),
+  m_current( nullptr ),
+  m_end( nullptr ),
+  m_next_chunk_size( std::max( chunk_size, size_t( 1 ) ) ) {
+}
+
+monotonic_resource::~monotonic_resource() {
+  release();
+}
+
+void monotonic_resource::release() {
+  while ( m_chunks ) {
+    chunk* next = m_chunks->next;
+    m_upstream->deallocate( m_chunks, m_chunks->size );
+    m_chunks = next;
+  }
+
+  m_current = nullptr;
+  m_end = nullptr;
+}
+
+memory_resource* monotonic_resource::upstream() const noexcept {
+  return m_upstream;
+}
+
+void* monotonic_resource::do_allocate( const size_t bytes, const size_t alignment ) {
+  const auto aligned = [ alignment ]( char* p ) {
+    const uintptr_t v = reinterpret_cast< uintptr_t >( p );
+    return reinterpret_cast< char* >( ( v + alignment - 1 ) / alignment * alignment );
+  };
+
+  char* result = m_current ? aligned( m_current ) : nullptr;
+  if ( !result || result > m_end || size_t( m_end - result ) < bytes ) {
+    const size_t header = chunk_header_size( sizeof( chunk ) );
+    const size_t size = std::max( m_next_chunk_size, header + bytes + alignment );
+
+    chunk* ch = static_cast< chunk* >( m_upstream->allocate( size ) );
+    ch->next = m_chunks;
+    ch->size = size;
+    m_chunks = ch;
+
+    m_current = reinterpret_cast< char* >( ch ) + header;
+    m_end = reinterpret_cast< char* >( ch ) + size;
+    m_next_chunk_size = size * 2;
+
+    result = aligned( m_current );
+  }
+
+  m_current = result + bytes;
+  return result;
+}
+
+void monotonic_resource::do_deallocate( void*, const size_t, const size_t ) {
+}
+
+//=============================================================================
+//
+// pool_resource
+//
+//=============================================================================
+pool_resource::pool_resource( memory_resource* upstream ):
+  m_upstream( upstream ),
+  m_chunks( nullptr ),
+  m_large( nullptr ) {
+  m_free.fill( nullptr );
+}
+
+pool_resource::~pool_resource() {
+  release();
+}
+
+void pool_resource::release() {
+  while ( m_chunks ) {
+    chunk* next = m_chunks->next;
+    m_upstream->deallocate( m_chunks, m_chunks->size );
+    m_chunks = next;
+  }
+
+  while ( m_large ) {
+    large_block* next = m_large->next;
+    m_upstream->deallocate( m_large, m_large->size, m_large->alignment );
+    m_large = next;
+  }
+
+  m_free.fill( nullptr );
+}
+
+memory_resource* pool_resource::upstream() const noexcept {
+  return m_upstream;
+}
+
+size_t pool_resource::size_class( const size_t bytes ) noexcept {
+  size_t result( 0 );
+  while ( ( min_block_size << result ) < bytes ) {
+    ++result;
+  }
+
+  return result;
+}
+
+size_t pool_resource::large_header_size( const size_t alignment ) noexcept {
+  const size_t align = std::max( alignment, alignof( std::max_align_t ) );
+  return ( sizeof( large_block ) + align - 1 ) / align * align;
+}
+
+void* pool_resource::do_allocate( const size_t bytes, const size_t alignment ) {
+  if ( bytes > max_block_size || alignment > alignof( std::max_align_t ) ) {
+    // kept in a list behind a header, so that release frees them as well
+    const size_t header = large_header_size( alignment );
+    if ( bytes > std::numeric_limits< size_t >::max() - header ) {
+      throw std::bad_alloc();
+    }
+
+    const size_t align = std::max( alignment, alignof( std::max_align_t ) );
+    large_block* lb = static_cast< large_block* >( m_upstream->allocate( header + bytes, align ) );
+    lb->prev = nullptr;
+    lb->next = m_large;
+    lb->size = header + bytes;
+    lb->alignment = align;
+    if ( m_large ) {
+      m_large->prev = lb;
+    }
+    m_large = lb;
+
+    return reinterpret_cast< char* >( lb ) + header;
+  }
+
+  const size_t cls = size_class( bytes );
+  if ( !m_free[ cls ] ) {
+    // blocks are multiples of max_align_t, so carving keeps them aligned
+    const size_t block_size = min_block_size << cls;
+    const size_t header = chunk_header_size( sizeof( chunk ) );
+    const size_t count = std::max( ( chunk_size - header ) / block_size, size_t( 1 ) );
+    const size_t size = header + count * block_size;
+
+    chunk* ch = static_cast< chunk* >( m_upstream->allocate( size ) );
+    ch->next = m_chunks;
+    ch->size = size;
+    m_chunks = ch;
+
+    char* first = reinterpret_cast< char* >( ch ) + header;
+    for ( size_t i = count; i > 0; --i ) {
+      block* b = reinterpret_cast< block* >( first + ( i - 1 ) * block_size );
+      b->next = m_free[ cls ];
+      m_free[ cls ] = b;
+    }
+  }
+
+  block* result = m_free[ cls ];
+  m_free[ cls ] = result->next;
+
+  return result;
+}
+
+void pool_resource::do_deallocate( void* p, const size_t bytes, const size_t alignment ) {
+  if ( bytes > max_block_size || alignment > alignof( std::max_align_t ) ) {
+    large_block* lb = reinterpret_cast< large_block* >( static_cast< char* >( p ) - large_header_size( alignment ) );
+    ( lb->prev ? lb->prev->next : m_large ) = lb->next;
+    if ( lb->next ) {
+      lb->next->prev = lb->prev;
+    }
+
+    m_upstream->deallocate( lb, lb->size, lb->alignment );
+    return;
+  }
+
+  block* b = static_cast< block* >( p );
+  const size_t cls = size_class( bytes );
+  b->next = m_free[ cls ];
+  m_free[ cls ] = b;
+}
+
+}
@@ -0,0 +1,67 @@
+#include "query.h"
+
+#include <cassert>
+
+namespace ecs {
+
+query_base::query_base( memory_resource* resource ):
+  m_ids( resource_allocator< eid_t >( resource ) ),
+  m_positions( resource ) {
+}
+
+void query_base::on_removed( const eid_t id ) {
+  if ( !contains( id ) ) {
+    return;
+  }
+
+  // swap with the last id
+  const size_t pos = m_positions.get_unsafe( id );
+  const eid_t last = m_ids.back();
+  m_ids[ pos ] = last;
+  m_positions.get_unsafe( last ) = pos;
+
+  m_ids.pop_back();
+  m_positions.erase( id );
+}
+
+void query_base::on_removed_range( const eid_t first, const eid_t last ) {
+  if ( first >= last ) {
+    return;
+  }
+
+  if ( last - first < m_ids.size() ) {
+    for ( eid_t id = first; id < last; ++id ) {
+      on_removed( id );
+    }
+
+    return;
+  }
+
+  for ( size_t i = m_ids.size(); i > 0; --i ) {
+    const eid_t id = m_ids[ i - 1 ];
+    if ( id >= first && id < last ) {
+      on_removed( id );
+    }
+  }
+}
+
+bool query_base::contains( const eid_t id ) const {
+  return m_positions.exist( id );
+}
+
+size_t query_base::size() const {
+  return m_ids.size();
+}
+
+const query_base::id_vector& query_base::ids() const {
+  return m_ids;
+}
+
+void query_base::insert( const eid_t id ) {
+  assert( !contains( id ) );
+
+  m_positions.emplace( id, m_ids.size() );
+  m_ids.push_back( id );
+}
+
+}
@@ -4,7 +4,9 @@
 
 namespace ecs {
 
-registry::registry():
+registry::registry( const storage_backend backend, memory_resource* resource ):
+  m_freeEntityIds( resource ),
+  m_components( backend, resource ),
   m_entityIdCounter( 0 ),
   m_rebuildDependencyTree( false ) {
 }
@@ -42,6 +44,10 @@ components_storage& registry::components() {
   return m_components;
 }
 
+memory_resource* registry::resource() const {
+  return m_components.resource();
+}
+
 void registry::update() {
   for ( auto& h : m_handlers ) {
     if ( h ) {
@@ -0,0 +1,156 @@
+#include "snapshot.h"
+
+#include <stdexcept>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define ECS_SNAPSHOT_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ecs {
+
+//=============================================================================
+//
+// snapshot_writer
+//
+//=============================================================================
+snapshot_writer::snapshot_writer( const std::string& path ):
+  m_file( std::fopen( path.c_str(), "wb" ) ) {
+  if ( !m_file ) {
+    throw std::runtime_error( "Can't open snapshot file " + path );
+  }
+
+  write_value( uint32_t( magic ) );
+  write_value( uint32_t( version ) );
+}
+
+snapshot_writer::~snapshot_writer() {
+  if ( m_file ) {
+    std::fclose( m_file );
+  }
+}
+
+void snapshot_writer::write( const void* data, const size_t bytes ) {
+  if ( !m_file ) {
+    throw std::runtime_error( "Snapshot file is closed" );
+  }
+
+  if ( bytes != 0 && std::fwrite( data, 1, bytes, m_file ) != bytes ) {
+    throw std::runtime_error( "Can't write snapshot file" );
+  }
+}
+
+void snapshot_writer::close() {
+  if ( !m_file ) {
+    return;
+  }
+
+  const int result = std::fclose( m_file );
+  m_file = nullptr;
+
+  if ( result != 0 ) {
+    throw std::runtime_error( "Can't write snapshot file" );
+  }
+}
+
+//=============================================================================
+//
+// snapshot_reader
+//
+//=============================================================================
+snapshot_reader::snapshot_reader( const std::string& path ):
+  m_data( nullptr ),
+  m_size( 0 ),
+  m_pos( 0 ),
+  m_mapped( false ) {
+#ifdef ECS_SNAPSHOT_MMAP
+  const int fd = ::open( path.c_str(), O_RDONLY );
+  if ( fd < 0 ) {
+    throw std::runtime_error( "Can't open snapshot file " + path );
+  }
+
+  struct stat st;
+  if ( ::fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+    void* p = ::mmap( nullptr, static_cast< size_t >( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( p != MAP_FAILED ) {
+      m_data = static_cast< const char* >( p );
+      m_size = static_cast< size_t >( st.st_size );
+      m_mapped = true;
+    }
+  }
+
+  ::close( fd );
+#endif
+
+  if ( !m_mapped ) {
+    // no mmap or it failed, read the file at once
+    std::FILE* file = std::fopen( path.c_str(), "rb" );
+    if ( !file ) {
+      throw std::runtime_error( "Can't open snapshot file " + path );
+    }
+
+    char chunk[ 64 * 1024 ];
+    size_t bytes;
+    while ( ( bytes = std::fread( chunk, 1, sizeof( chunk ), file ) ) != 0 ) {
+      m_buffer.insert( m_buffer.end(), chunk, chunk + bytes );
+    }
+
+    const bool failed = std::ferror( file ) != 0;
+    std::fclose( file );
+    if ( failed ) {
+      throw std::runtime_error( "Can't read snapshot file " + path );
+    }
+
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+  }
+
+  try {
+    if ( read_value< uint32_t >() != snapshot_writer::magic ) {
+      throw std::runtime_error( "Not a snapshot file " + path );
+    }
+
+    if ( read_value< uint32_t >() != snapshot_writer::version ) {
+      throw std::runtime_error( "Unsupported snapshot version in " + path );
+    }
+  } catch ( ... ) {
+    unmap();
+    throw;
+  }
+}
+
+snapshot_reader::~snapshot_reader() {
+  unmap();
+}
+
+void snapshot_reader::unmap() {
+#ifdef ECS_SNAPSHOT_MMAP
+  if ( m_mapped ) {
+    ::munmap( const_cast< char* >( m_data ), m_size );
+    m_mapped = false;
+  }
+#endif
+}
+
+const void* snapshot_reader::read( const size_t bytes ) {
+  if ( bytes > m_size - m_pos ) {
+    throw std::runtime_error( "Unexpected end of snapshot file" );
+  }
+
+  const char* result = m_data + m_pos;
+  m_pos += bytes;
+  return result;
+}
+
+size_t snapshot_reader::remaining() const {
+  return m_size - m_pos;
+}
+
+bool snapshot_reader::mapped() const {
+  return m_mapped;
+}
+
+}
@@ -0,0 +1,91 @@
+#include "thread_pool.h"
+
+namespace ecs {
+
+thread_pool::thread_pool( const size_t threads ):
+  m_task( nullptr ),
+  m_count( 0 ),
+  m_next( 0 ),
+  m_pending( 0 ),
+  m_stop( false ) {
+  for ( size_t i = 1; i < threads; ++i ) {
+    m_threads.emplace_back( &thread_pool::worker, this );
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_stop = true;
+  }
+
+  m_wake.notify_all();
+  for ( auto& t : m_threads ) {
+    t.join();
+  }
+}
+
+void thread_pool::run( const size_t count, const std::function< void( const size_t ) >& task ) {
+  std::lock_guard< std::mutex > run_lock( m_run );
+  std::unique_lock< std::mutex > lock( m_mutex );
+
+  m_task = &task;
+  m_count = count;
+  m_next = 0;
+  m_pending = count;
+  m_error = nullptr;
+  m_wake.notify_all();
+
+  work( lock );
+  m_done.wait( lock, [ this ]() { return m_pending == 0; } );
+
+  m_task = nullptr;
+
+  std::exception_ptr error;
+  std::swap( error, m_error );
+  if ( error ) {
+    std::rethrow_exception( error );
+  }
+}
+
+size_t thread_pool::thread_count() const {
+  return m_threads.size() + 1;
+}
+
+void thread_pool::worker() {
+  std::unique_lock< std::mutex > lock( m_mutex );
+  while ( true ) {
+    m_wake.wait( lock, [ this ]() { return m_stop || ( m_task && m_next < m_count ); } );
+    if ( m_stop ) {
+      return;
+    }
+
+    work( lock );
+  }
+}
+
+void thread_pool::work( std::unique_lock< std::mutex >& lock ) {
+  while ( m_task && m_next < m_count ) {
+    const auto& task = *m_task;
+    const size_t idx = m_next++;
+
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+      task( idx );
+    } catch ( ... ) {
+      error = std::current_exception();
+    }
+    lock.lock();
+
+    if ( error && !m_error ) {
+      m_error = error;
+    }
+
+    if ( --m_pending == 0 ) {
+      m_done.notify_all();
+    }
+  }
+}
+
+}
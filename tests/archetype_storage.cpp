@@ -0,0 +1,194 @@
+#include "common.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <registry.h>
+
+#include <algorithm>
+#include <string>
+
+TEST_CASE( "modify" ) {
+
+SECTION( "add" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+
+  const auto& p = s.add_entity_component< Position >( 200, 3.1415f, 2.7182f );
+  const auto pc = s.get_entity_component< Position >( 200 );
+
+  REQUIRE( pc == &p );
+  REQUIRE( *pc == Position( 3.1415f, 2.7182f ) );
+  REQUIRE( s.get_entity_component< Velocity >( 200 ) == nullptr );
+  REQUIRE( s.get_entity_component< Position >( 201 ) == nullptr );
+}
+
+SECTION( "add_moves_entity" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  s.add_entity_component< Position >( 200, 3.1415f, 2.7182f );
+  s.add_entity_component< Position >( 201, 1.0f, 2.0f );
+  s.add_entity_component< Velocity >( 200, 1.4142f, 9.81f );
+
+  REQUIRE( *s.get_entity_component< Position >( 200 ) == Position( 3.1415f, 2.7182f ) );
+  REQUIRE( *s.get_entity_component< Velocity >( 200 ) == Velocity( 1.4142f, 9.81f ) );
+  REQUIRE( *s.get_entity_component< Position >( 201 ) == Position( 1.0f, 2.0f ) );
+}
+
+SECTION( "set" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  s.add_entity_component< Position >( 200, 1.0f, 2.0f );
+
+  s.set_entity_component< Position >( 200, Position( 3.0f, 4.0f ) );
+  s.set_entity_component< Velocity >( 200, Velocity( 5.0f, 6.0f ) );
+
+  REQUIRE( *s.get_entity_component< Position >( 200 ) == Position( 3.0f, 4.0f ) );
+  REQUIRE( *s.get_entity_component< Velocity >( 200 ) == Velocity( 5.0f, 6.0f ) );
+}
+
+SECTION( "remove" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  s.add_entity_component< Position >( 200, 1.0f, 2.0f );
+  s.add_entity_component< Velocity >( 200, 5.0f, 6.0f );
+  s.add_entity_component< Position >( 201, 3.0f, 4.0f );
+
+  s.remove_entity_component< Position >( 200 );
+  s.remove_entity_component< Position >( 202 );
+
+  REQUIRE( s.get_entity_component< Position >( 200 ) == nullptr );
+  REQUIRE( *s.get_entity_component< Velocity >( 200 ) == Velocity( 5.0f, 6.0f ) );
+  REQUIRE( *s.get_entity_component< Position >( 201 ) == Position( 3.0f, 4.0f ) );
+}
+
+SECTION( "remove_all" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  s.add_entity_component< Position >( 200, 1.0f, 2.0f );
+  s.add_entity_component< Velocity >( 200, 5.0f, 6.0f );
+
+  s.remove_all_components( 200 );
+
+  REQUIRE( s.get_entity_component< Position >( 200 ) == nullptr );
+  REQUIRE( s.get_entity_component< Velocity >( 200 ) == nullptr );
+}
+
+SECTION( "non_trivial_components" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  for ( ecs::eid_t i = 0; i < 3000; ++i ) {
+    s.add_entity_component< std::string >( i, std::to_string( i ) + " is long enough to allocate" );
+    if ( i % 3 == 0 ) {
+      s.add_entity_component< Position >( i, 1.0f, 2.0f );
+    }
+  }
+
+  for ( ecs::eid_t i = 0; i < 3000; i += 2 ) {
+    s.remove_all_components( i );
+  }
+
+  for ( ecs::eid_t i = 1; i < 3000; i += 2 ) {
+    REQUIRE( *s.get_entity_component< std::string >( i ) == std::to_string( i ) + " is long enough to allocate" );
+  }
+}
+
+}
+
+TEST_CASE( "join" ) {
+
+SECTION( "join" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  s.add_entity_component< Position >( 200, 3.1415f, 2.7182f );
+  s.add_entity_component< Position >( 201, 1.0f, 2.0f );
+  s.add_entity_component< Velocity >( 201, 1.4142f, 9.81f );
+  s.add_entity_component< Velocity >( 202, 20.0f, 3.0f );
+
+  size_t called = 0;
+  s.join< Position, Velocity >( [ & ]( const ecs::eid_t id, Position& p, const Velocity& v ) {
+    ++called;
+    REQUIRE( id == 201 );
+    REQUIRE( v == Velocity( 1.4142f, 9.81f ) );
+    p.x += v.x;
+  } );
+
+  REQUIRE( called == 1 );
+  REQUIRE( s.get_entity_component< Position >( 201 )->x == 1.0f + 1.4142f );
+}
+
+SECTION( "join_many_chunks" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  for ( ecs::eid_t i = 0; i < 10000; ++i ) {
+    s.add_entity_component< Position >( i, 1.0f, 2.0f );
+    if ( i % 2 ) {
+      s.add_entity_component< Velocity >( i, 1.0f, 2.0f );
+    }
+  }
+
+  std::vector< ecs::eid_t > ids;
+  s.join< Position >( [ & ]( const ecs::eid_t id, const Position& ) {
+    ids.push_back( id );
+  } );
+
+  std::sort( ids.begin(), ids.end() );
+  REQUIRE( ids.size() == 10000 );
+  REQUIRE( std::unique( ids.begin(), ids.end() ) == ids.end() );
+}
+
+SECTION( "join_exclude" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  s.add_entity_component< Position >( 200, 3.1415f, 2.7182f );
+  s.add_entity_component< Position >( 201, 1.0f, 2.0f );
+  s.add_entity_component< Position >( 202, 3.1415f, 2.7182f );
+  s.add_entity_component< Velocity >( 201, 1.4142f, 9.81f );
+
+  std::vector< ecs::eid_t > ids;
+  s
+    .join< Position >()
+    .exclude< Velocity >( [ & ]( const ecs::eid_t id, const Position& ) {
+    ids.push_back( id );
+  } );
+
+  std::sort( ids.begin(), ids.end() );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 200, 202 } );
+}
+
+SECTION( "join_remove_in_callback" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  for ( ecs::eid_t i = 0; i < 5000; ++i ) {
+    s.add_entity_component< Position >( i, 1.0f, 2.0f );
+  }
+
+  size_t called = 0;
+  s.join< Position >( [ & ]( const ecs::eid_t id, const Position& ) {
+    ++called;
+    if ( id % 2 ) {
+      s.remove_entity_component< Position >( id );
+    } else {
+      s.add_entity_component< Velocity >( id, 1.0f, 2.0f );
+    }
+  } );
+
+  REQUIRE( called == 5000 );
+
+  size_t left = 0;
+  s.join< Position, Velocity >( [ & ]( const ecs::eid_t id, const Position&, const Velocity& ) {
+    ++left;
+    REQUIRE( id % 2 == 0 );
+  } );
+
+  REQUIRE( left == 2500 );
+}
+
+}
+
+TEST_CASE( "registry" ) {
+
+SECTION( "entity_components" ) {
+  ecs::registry r( ecs::storage_backend::archetype );
+  auto e = r.allocate();
+
+  e.add< Position >( 3.1415f, 2.7182f );
+  e.set< Velocity >( Velocity( 1.0f, 2.0f ) );
+  REQUIRE( *e.get< Position >() == Position( 3.1415f, 2.7182f ) );
+  REQUIRE( *e.get< Velocity >() == Velocity( 1.0f, 2.0f ) );
+
+  r.deallocate( e );
+  REQUIRE( r.components().get_entity_component< Position >( e.id() ) == nullptr );
+}
+
+}
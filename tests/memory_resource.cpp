@@ -0,0 +1,189 @@
+#include "common.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <memory_resource.h>
+#include <storage.h>
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <set>
+#include <vector>
+
+namespace {
+
+// forwards to new_delete_resource and keeps count of what is outstanding
+class counting_resource: public ecs::memory_resource {
+public:
+  size_t allocations = 0;
+  size_t outstanding = 0;
+
+protected:
+  void* do_allocate( const size_t bytes, const size_t alignment ) override {
+    ++allocations;
+    outstanding += bytes;
+    return ecs::new_delete_resource()->allocate( bytes, alignment );
+  }
+
+  void do_deallocate( void* p, const size_t bytes, const size_t alignment ) override {
+    outstanding -= bytes;
+    ecs::new_delete_resource()->deallocate( p, bytes, alignment );
+  }
+};
+
+bool aligned( const void* p, const size_t alignment ) {
+  return reinterpret_cast< uintptr_t >( p ) % alignment == 0;
+}
+
+}
+
+TEST_CASE( "monotonic_resource" ) {
+  counting_resource upstream;
+  {
+    ecs::monotonic_resource arena( &upstream, 1024 );
+
+    std::set< void* > blocks;
+    for ( size_t i = 1; i < 100; ++i ) {
+      void* p = arena.allocate( i, i % 2 ? 8 : 16 );
+      REQUIRE( aligned( p, i % 2 ? 8 : 16 ) );
+      blocks.insert( p );
+      arena.deallocate( p, i );
+    }
+
+    // chunks double, so a few of them hold everything
+    REQUIRE( blocks.size() == 99 );
+    REQUIRE( upstream.allocations < 6 );
+
+    arena.allocate( 100000 );
+    arena.release();
+    REQUIRE( upstream.outstanding == 0 );
+
+    arena.allocate( 10 );
+  }
+
+  REQUIRE( upstream.outstanding == 0 );
+}
+
+TEST_CASE( "pool_resource" ) {
+  counting_resource upstream;
+  {
+    ecs::pool_resource pool( &upstream );
+
+    void* a = pool.allocate( 100 );
+    void* b = pool.allocate( 100 );
+    REQUIRE( a != b );
+    REQUIRE( aligned( a, alignof( std::max_align_t ) ) );
+    REQUIRE( upstream.allocations == 1 );
+
+    pool.deallocate( a, 100 );
+    REQUIRE( pool.allocate( 120 ) == a );
+
+    // past the largest class
+    const size_t pooled = upstream.outstanding;
+    void* big = pool.allocate( ecs::pool_resource::max_block_size + 1 );
+    REQUIRE( upstream.allocations == 2 );
+    pool.deallocate( big, ecs::pool_resource::max_block_size + 1 );
+    REQUIRE( upstream.outstanding == pooled );
+
+    // large and over-aligned blocks are given back by release too
+    void* huge = pool.allocate( 2 << 20 );
+    std::memset( huge, 1, 2 << 20 );
+    void* wide = pool.allocate( 64, 256 );
+    void* other = pool.allocate( 64, 128 );
+    REQUIRE( aligned( wide, 256 ) );
+    REQUIRE( aligned( other, 128 ) );
+    pool.deallocate( wide, 64, 256 );
+
+    pool.release();
+    REQUIRE( upstream.outstanding == 0 );
+
+    pool.allocate( 2 << 20 );
+  }
+
+  REQUIRE( upstream.outstanding == 0 );
+}
+
+TEST_CASE( "resource_allocator" ) {
+  counting_resource upstream;
+
+  SECTION( "vector" ) {
+    std::vector< int, ecs::resource_allocator< int > > v( &upstream );
+    v.resize( 1000, 7 );
+    REQUIRE( upstream.outstanding >= 1000 * sizeof( int ) );
+    REQUIRE( ecs::resource_allocator< char >( v.get_allocator() ).resource() == &upstream );
+
+    v.clear();
+    v.shrink_to_fit();
+    REQUIRE( upstream.outstanding == 0 );
+  }
+
+  SECTION( "components_storage" ) {
+    {
+      ecs::components_storage s( ecs::storage_backend::sparse, &upstream );
+      for ( ecs::eid_t i = 0; i < 1000; ++i ) {
+        s.add_entity_component< Position >( i, 1.0f, 2.0f );
+        s.add_entity_component< Velocity >( i * 7, 3.0f, 4.0f );
+      }
+
+      REQUIRE( upstream.outstanding > 1000 * ( sizeof( Position ) + sizeof( Velocity ) ) );
+      REQUIRE( s.get_entity_component< Velocity >( 700 )->x == 3.0f );
+
+      // id map of a query
+      const size_t before = upstream.outstanding;
+      REQUIRE( s.query< Position, Velocity >().size() == 143 );
+      REQUIRE( upstream.outstanding > before );
+      REQUIRE( s.query< Position, Velocity >().ids().get_allocator().resource() != ecs::new_delete_resource() );
+    }
+
+    REQUIRE( upstream.outstanding == 0 );
+  }
+
+  SECTION( "slot_versions" ) {
+    {
+      ecs::sparse_vector< int, 64, ecs::ordered_page_policy, ecs::resource_allocator< int > > v( &upstream );
+      v.track_slot_versions( true );
+      v.insert( 5, 5 );
+
+      const size_t before = upstream.outstanding;
+      v.touch( 5, 1 );
+      REQUIRE( upstream.outstanding == before + 64 * sizeof( uint64_t ) );
+      REQUIRE( v.version( 5 ) == 1 );
+
+      v.clear();
+      REQUIRE( upstream.outstanding < before );
+    }
+
+    REQUIRE( upstream.outstanding == 0 );
+  }
+
+  SECTION( "archetype_backend" ) {
+    {
+      ecs::components_storage s( ecs::storage_backend::archetype, &upstream );
+      for ( ecs::eid_t i = 0; i < 1000; ++i ) {
+        s.add_entity_component< Position >( i, 1.0f, 2.0f );
+      }
+
+      // chunks
+      REQUIRE( upstream.outstanding > 1000 * sizeof( Position ) );
+
+      s.remove_all_components( 999 );
+      REQUIRE( s.get_entity_component< Position >( 998 )->y == 2.0f );
+    }
+
+    REQUIRE( upstream.outstanding == 0 );
+  }
+}
+
+TEST_CASE( "new_delete_resource" ) {
+  ecs::memory_resource* resource = ecs::new_delete_resource();
+  for ( size_t alignment = 1; alignment <= 4096; alignment *= 2 ) {
+    void* p = resource->allocate( 100, alignment );
+    REQUIRE( aligned( p, alignment ) );
+    std::memset( p, 0, 100 );
+    resource->deallocate( p, 100, alignment );
+  }
+
+  REQUIRE_THROWS_AS( resource->allocate( 100, 3 * alignof( std::max_align_t ) ), std::bad_alloc );
+}
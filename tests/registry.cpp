@@ -92,6 +92,21 @@ SECTION( "remove" ) {
   REQUIRE( e.get< Position >() == nullptr );
 }
 
+SECTION( "arena" ) {
+  ecs::monotonic_resource arena;
+  ecs::registry r( ecs::storage_backend::sparse, &arena );
+  REQUIRE( r.resource() == &arena );
+
+  auto e1 = r.allocate();
+  auto e2 = r.allocate();
+  e1.add< Position >( 1.0f, 2.0f );
+  e2.add< Velocity >( 3.0f, 4.0f );
+  r.deallocate( e1 );
+
+  REQUIRE( r.allocate().id() == e1.id() );
+  REQUIRE( e2.get< Velocity >()->y == 4.0f );
+}
+
 }
 
 TEST_CASE( "systems" ) {
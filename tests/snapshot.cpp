@@ -0,0 +1,252 @@
+#include "common.h"
+
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <registry.h>
+#include <snapshot.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const char* const snapshot_path = "snapshot_test.bin";
+
+struct Health {
+  int value;
+};
+
+// same layout as Health, kept in ordered pages
+struct Armor {
+  int value;
+};
+
+}
+
+namespace ecs {
+
+template <>
+struct component_traits< Health >: public default_component_traits< Health > {
+  static const size_t page_size = 128;
+  using page_policy = unordered_page_policy;
+};
+
+template <>
+struct component_traits< Armor >: public default_component_traits< Armor > {
+  static const size_t page_size = 128;
+};
+
+}
+
+TEST_CASE( "snapshot" ) {
+
+SECTION( "registry" ) {
+  {
+    ecs::registry r;
+    for ( int i = 0; i < 1000; ++i ) {
+      auto e = r.allocate();
+      if ( i % 2 == 0 ) {
+        e.add< Position >( float( i ), 1.0f );
+      }
+      if ( i % 3 == 0 ) {
+        e.add< Health >( Health{ 1000 - i } );
+      }
+    }
+
+    r.deallocate( 7 );
+    r.deallocate( 500 );
+    r.components().remove_entity_component< Health >( 3 );
+
+    r.save_snapshot< Position, Health >( snapshot_path );
+  }
+
+  ecs::registry r;
+  auto& q = r.components().query< Position, Health >();
+  r.allocate().add< Position >( -1.0f, -1.0f );
+  const auto since = r.components().tick();
+  r.components().advance_tick();
+  r.load_snapshot< Position, Health >( snapshot_path );
+
+  size_t positions( 0 );
+  r.components().join< Position >( [ & ]( const ecs::eid_t id, const Position& p ) {
+    REQUIRE( p == Position( float( id ), 1.0f ) );
+    ++positions;
+  } );
+  REQUIRE( positions == 499 );
+
+  REQUIRE( r.components().get_entity_component< Health >( 999 )->value == 1 );
+  REQUIRE( r.components().get_entity_component< Health >( 3 ) == nullptr );
+  REQUIRE( r.components().get_entity_component< Position >( 500 ) == nullptr );
+  REQUIRE( q.size() == 167 );
+
+  // loaded components count as modified
+  size_t changed( 0 );
+  r.components().join_changed< Health >( since, [ & ]( const ecs::eid_t, const Health& ) {
+    ++changed;
+  } );
+  REQUIRE( changed == 333 );
+
+  REQUIRE( r.allocate().id() == 7 );
+  REQUIRE( r.allocate().id() == 500 );
+  REQUIRE( r.allocate().id() == 1000 );
+
+  std::remove( snapshot_path );
+}
+
+SECTION( "mismatch" ) {
+  {
+    ecs::registry r;
+    r.allocate().add< Position >( 1.0f, 2.0f );
+    r.save_snapshot< Position >( snapshot_path );
+  }
+
+  ecs::registry r;
+  REQUIRE_THROWS_AS( r.load_snapshot< Health >( snapshot_path ), std::runtime_error );
+  REQUIRE_THROWS_AS( ( r.load_snapshot< Position, Health >( snapshot_path ) ), std::runtime_error );
+
+  // truncated file
+  std::vector< char > bytes;
+  {
+    std::ifstream in( snapshot_path, std::ios::binary );
+    bytes.assign( std::istreambuf_iterator< char >( in ), std::istreambuf_iterator< char >() );
+  }
+  {
+    std::ofstream out( snapshot_path, std::ios::binary | std::ios::trunc );
+    out.write( bytes.data(), static_cast< std::streamsize >( bytes.size() - 1 ) );
+  }
+  REQUIRE_THROWS_AS( r.load_snapshot< Position >( snapshot_path ), std::runtime_error );
+  REQUIRE( r.components().get_entity_component< Position >( 0 ) == nullptr );
+
+  {
+    std::ofstream out( snapshot_path, std::ios::binary | std::ios::trunc );
+    out << "not a snapshot";
+  }
+  REQUIRE_THROWS_AS( ecs::snapshot_reader( snapshot_path ), std::runtime_error );
+
+  std::remove( snapshot_path );
+  REQUIRE_THROWS_AS( ecs::snapshot_reader( snapshot_path ), std::runtime_error );
+}
+
+SECTION( "entity_ids" ) {
+  {
+    ecs::registry r;
+    for ( int i = 0; i < 4; ++i ) {
+      r.allocate().add< Health >( Health{ i } );
+    }
+
+    r.deallocate( 1 );
+    r.deallocate( 2 );
+    r.save_snapshot< Health >( snapshot_path );
+  }
+
+  std::vector< char > bytes;
+  {
+    std::ifstream in( snapshot_path, std::ios::binary );
+    bytes.assign( std::istreambuf_iterator< char >( in ), std::istreambuf_iterator< char >() );
+  }
+
+  // file header, size of ids, id counter, count of free ids, free ids
+  const size_t counter = 16;
+  const size_t free_ids = counter + sizeof( ecs::eid_t ) + 8;
+  ecs::eid_t first;
+  std::memcpy( &first, &bytes[ free_ids ], sizeof( first ) );
+  REQUIRE( ( first == 1 || first == 2 ) );
+
+  const auto load = [ & ]( const size_t offset, const ecs::eid_t value ) {
+    std::vector< char > corrupted( bytes );
+    std::memcpy( &corrupted[ offset ], &value, sizeof( value ) );
+    {
+      std::ofstream out( snapshot_path, std::ios::binary | std::ios::trunc );
+      out.write( corrupted.data(), static_cast< std::streamsize >( corrupted.size() ) );
+    }
+
+    ecs::registry r;
+    r.allocate().add< Health >( Health{ 10 } );
+    REQUIRE_THROWS_AS( r.load_snapshot< Health >( snapshot_path ), std::runtime_error );
+    REQUIRE( r.allocate().id() == 1 );
+    return r.components().get_entity_component< Health >( 0 ) != nullptr;
+  };
+
+  // rejected before anything is loaded
+  REQUIRE( load( free_ids, ecs::eid_t( 3 - first ) ) );
+  REQUIRE( load( free_ids, 4 ) );
+
+  // components loaded for free or unallocated ids are dropped
+  REQUIRE( !load( free_ids, 0 ) );
+  REQUIRE( !load( counter, 3 ) );
+
+  std::remove( snapshot_path );
+}
+
+SECTION( "corrupted" ) {
+  {
+    ecs::components_storage s;
+    s.add_entity_component< Health >( 1, Health{ 10 } );
+    s.add_entity_component< Health >( 2, Health{ 20 } );
+    ecs::snapshot_writer out( snapshot_path );
+    s.save< Health >( out );
+  }
+
+  std::vector< char > bytes;
+  {
+    std::ifstream in( snapshot_path, std::ios::binary );
+    bytes.assign( std::istreambuf_iterator< char >( in ), std::istreambuf_iterator< char >() );
+  }
+
+  // file header, count of types, storage header, counts of pages and
+  // elements, page header, then byte wide index tables and the mask
+  const size_t elements = 56;
+  const size_t index = 80;
+  const size_t back_index = index + 128;
+  const size_t mask = back_index + 128;
+  REQUIRE( bytes[ elements ] == 2 );
+  REQUIRE( bytes[ index + 2 ] == 1 );
+  REQUIRE( bytes[ back_index + 1 ] == 2 );
+  REQUIRE( bytes[ mask ] == 6 );
+
+  const auto load = [ & ]( const size_t offset, const char value ) {
+    std::vector< char > corrupted( bytes );
+    corrupted[ offset ] = value;
+    {
+      std::ofstream out( snapshot_path, std::ios::binary | std::ios::trunc );
+      out.write( corrupted.data(), static_cast< std::streamsize >( corrupted.size() ) );
+    }
+
+    ecs::components_storage s;
+    ecs::snapshot_reader in( snapshot_path );
+    REQUIRE_THROWS_AS( s.load< Health >( in ), std::runtime_error );
+    REQUIRE( s.get_entity_component< Health >( 1 ) == nullptr );
+  };
+
+  load( elements, 3 );
+  load( mask, 7 );
+  load( back_index + 1, 3 );
+  load( back_index + 1, char( 200 ) );
+  load( back_index + 2, 3 );
+  load( index + 3, 0 );
+
+  {
+    std::ofstream out( snapshot_path, std::ios::binary | std::ios::trunc );
+    out.write( bytes.data(), static_cast< std::streamsize >( bytes.size() ) );
+  }
+
+  // another page policy
+  {
+    ecs::components_storage s;
+    ecs::snapshot_reader in( snapshot_path );
+    REQUIRE_THROWS_AS( s.load< Armor >( in ), std::runtime_error );
+  }
+
+  ecs::components_storage s;
+  ecs::snapshot_reader in( snapshot_path );
+  s.load< Health >( in );
+  REQUIRE( s.get_entity_component< Health >( 2 )->value == 20 );
+
+  std::remove( snapshot_path );
+}
+
+}
@@ -0,0 +1,145 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <soa_vector.h>
+
+#include <tuple>
+
+namespace {
+
+struct Point {
+  float x, y;
+
+  Point() {}
+  Point( const float _x, const float _y ):
+    x( _x ), y( _y ) {}
+};
+
+using point_fields = ecs::soa_fields<
+  ecs::soa_field< Point, float, &Point::x >,
+  ecs::soa_field< Point, float, &Point::y > >;
+
+using point_vector = ecs::soa_vector< Point, 64, point_fields >;
+
+}
+
+TEST_CASE( "init" ) {
+
+SECTION( "default" ) {
+    point_vector v;
+
+    auto range = v.index_range();
+    REQUIRE( range.first == v.bad_index );
+    REQUIRE( range.second == v.bad_index );
+    REQUIRE( v.size() == 0 );
+}
+
+}
+
+TEST_CASE( "modify" ) {
+
+SECTION( "emplace" ) {
+    point_vector v;
+    v.emplace( 70, 1.0f, 2.0f );
+
+    REQUIRE( v.exist( 70 ) == true );
+    REQUIRE( v.exist( 69 ) == false );
+    REQUIRE( v.get( 70 ).x == 1.0f );
+    REQUIRE( v.get( 70 ).y == 2.0f );
+    REQUIRE( v.field< 1 >( 70 ) == 2.0f );
+}
+
+SECTION( "emplace_existing" ) {
+    point_vector v;
+    v.emplace( 70, 1.0f, 2.0f );
+    v.emplace( 70, 3.0f, 4.0f );
+
+    REQUIRE( v.size() == 1 );
+    REQUIRE( v.get( 70 ).x == 1.0f );
+}
+
+SECTION( "set" ) {
+    point_vector v;
+    v.emplace( 70, 1.0f, 2.0f );
+    v.set( 70, Point( 3.0f, 4.0f ) );
+    v.set( 10, Point( 5.0f, 6.0f ) );
+
+    REQUIRE( v.size() == 2 );
+    REQUIRE( v.get( 70 ).x == 3.0f );
+    REQUIRE( v.get( 10 ).y == 6.0f );
+}
+
+SECTION( "erase" ) {
+    point_vector v;
+    v.emplace( 70, 1.0f, 2.0f );
+    v.emplace( 10, 1.0f, 2.0f );
+    v.erase( 70 );
+    v.erase( 13 );
+
+    auto range = v.index_range();
+    REQUIRE( range.first == 10 );
+    REQUIRE( range.second == 10 );
+    REQUIRE( v.exist( 70 ) == false );
+    REQUIRE( v.size() == 1 );
+}
+
+SECTION( "ranges" ) {
+    point_vector v;
+    v.emplace_range( 10, 200, 1.0f, 2.0f );
+    v.erase_range( 20, 200 );
+
+    auto range = v.index_range();
+    REQUIRE( range.first == 10 );
+    REQUIRE( range.second == 209 );
+    REQUIRE( v.size() == 20 );
+    REQUIRE( v.field< 1 >( 205 ) == 2.0f );
+}
+
+}
+
+TEST_CASE( "iterate" ) {
+
+SECTION( "for_each_index" ) {
+    point_vector v;
+    v.emplace( 70, 1.0f, 2.0f );
+    v.emplace( 10, 1.0f, 2.0f );
+    v.emplace( 11, 1.0f, 2.0f );
+
+    std::vector< size_t > ids;
+    v.for_each_index( [ & ]( const size_t id ) {
+        ids.push_back( id );
+        v.erase( id );
+    } );
+
+    REQUIRE( ids == std::vector< size_t >{ 10, 11, 70 } );
+    REQUIRE( v.size() == 0 );
+}
+
+SECTION( "for_each_page" ) {
+    point_vector v;
+    v.emplace( 70, 1.0f, 2.0f );
+    v.emplace( 3, 3.0f, 4.0f );
+
+    size_t pages = 0;
+    v.for_each_page( [ & ]( const size_t base, const uint64_t* mask, point_vector::pointers fields ) {
+        ++pages;
+        float* x = std::get< 0 >( fields );
+        for ( size_t i = 0; i < 64; ++i ) {
+            x[ i ] *= 2.0f;
+        }
+
+        if ( base == 0 ) {
+            REQUIRE( mask[ 0 ] == ( uint64_t( 1 ) << 3 ) );
+        } else {
+            REQUIRE( base == 64 );
+            REQUIRE( mask[ 0 ] == ( uint64_t( 1 ) << 6 ) );
+        }
+    } );
+
+    REQUIRE( pages == 2 );
+    REQUIRE( v.get( 70 ).x == 2.0f );
+    REQUIRE( v.get( 3 ).x == 6.0f );
+    REQUIRE( v.get( 3 ).y == 4.0f );
+}
+
+}
@@ -0,0 +1,166 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <sparse_set.h>
+
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using sparse_set = ecs::sparse_set< int, 8 >;
+
+std::vector< size_t > indices( const sparse_set& s, const size_t first = 0, const size_t last = sparse_set::bad_index ) {
+  std::vector< size_t > result;
+  s.for_each_index( first, last, [ &result ]( const size_t i ) { result.push_back( i ); } );
+  return result;
+}
+
+// throws when constructed from a negative value
+struct checked {
+  checked( const int v ):
+    value( v ) {
+    if ( v < 0 ) {
+      throw std::invalid_argument( "negative" );
+    }
+  }
+
+  int value;
+};
+
+}
+
+TEST_CASE( "modify" ) {
+
+SECTION( "insert_erase" ) {
+    sparse_set s;
+    REQUIRE( s.index_range().first == s.bad_index );
+
+    s.emplace( 70, 1 );
+    s.emplace( 70, 2 );
+    s.insert( 500, 3 );
+    s.set( 3, 4 );
+    s.set( 3, 5 );
+
+    REQUIRE( s.size() == 3 );
+    REQUIRE( s.exist( 70 ) );
+    REQUIRE( !s.exist( 71 ) );
+    REQUIRE( !s.exist( 100000 ) );
+    REQUIRE( s.get_unsafe( 70 ) == 1 );
+    REQUIRE( s.get_unsafe( 3 ) == 5 );
+    REQUIRE( s.index_range() == std::make_pair< size_t, size_t >( 3, 500 ) );
+    REQUIRE( indices( s ) == std::vector< size_t >{ 3, 70, 500 } );
+
+    // the last element fills the gap
+    s.erase( 70 );
+    REQUIRE( s.size() == 2 );
+    REQUIRE( s.data()[ 0 ] == 5 );
+    REQUIRE( s.ids()[ 0 ] == 3 );
+    REQUIRE( s.data()[ 1 ] == 3 );
+    REQUIRE( s.ids()[ 1 ] == 500 );
+    REQUIRE( s.get_unsafe( 500 ) == 3 );
+    REQUIRE( s.page_count() == 63 );
+
+    s.erase( 500 );
+    REQUIRE( s.index_range() == std::make_pair< size_t, size_t >( 3, 3 ) );
+    s.erase( 3 );
+    REQUIRE( s.size() == 0 );
+    REQUIRE( s.index_range().second == s.bad_index );
+}
+
+SECTION( "ranges" ) {
+    sparse_set s;
+    s.emplace_range( 4, 30, 7 );
+    REQUIRE( s.size() == 30 );
+    REQUIRE( indices( s, 10, 13 ) == std::vector< size_t >{ 10, 11, 12 } );
+
+    uint64_t mask( 0 );
+    s.mask_words( 0, 1, &mask );
+    REQUIRE( mask == ( ( uint64_t( 1 ) << 34 ) - 1 ) - 15 );
+
+    s.erase_range( 6, 30 );
+    REQUIRE( indices( s ) == std::vector< size_t >{ 4, 5, 30, 31, 32, 33 } );
+    for ( const auto i : indices( s ) ) {
+      REQUIRE( s.get_unsafe( i ) == 7 );
+    }
+
+    std::vector< size_t > ids{ 40, 5, 41 };
+    std::vector< int > values{ 1, 2, 3 };
+    s.insert_range( ids.begin(), ids.end(), values.begin() );
+    REQUIRE( s.size() == 8 );
+    REQUIRE( s.get_unsafe( 5 ) == 7 );
+    REQUIRE( s.get_unsafe( 41 ) == 3 );
+
+    // f erasing elements as it goes
+    s.for_each_index( [ &s ]( const size_t i ) { s.erase( i ); } );
+    REQUIRE( s.size() == 0 );
+}
+
+SECTION( "versions" ) {
+    sparse_set s;
+    s.emplace( 1, 0 );
+    s.emplace( 20, 0 );
+    s.touch( 1, 5 );
+    s.touch( 20, 3 );
+    s.touch( 20, 2 );
+    REQUIRE( s.version( 1 ) == 5 );
+    REQUIRE( s.page_version( 2 ) == 3 );
+    REQUIRE( s.version( 100 ) == 0 );
+
+    s.touch_all( 9 );
+    REQUIRE( s.version( 20 ) == 9 );
+}
+
+SECTION( "throwing_constructor" ) {
+    ecs::sparse_set< checked, 8 > s;
+    s.emplace( 3, 1 );
+    REQUIRE_THROWS_AS( s.emplace( 100, -1 ), std::invalid_argument );
+
+    // no empty page is left behind
+    REQUIRE( s.size() == 1 );
+    REQUIRE( !s.exist( 100 ) );
+    REQUIRE( s.next_page( 1 ) == s.bad_index );
+    REQUIRE( s.index_range() == std::make_pair< size_t, size_t >( 3, 3 ) );
+
+    s.emplace( 100, 2 );
+    REQUIRE( s.index_range() == std::make_pair< size_t, size_t >( 3, 100 ) );
+    REQUIRE( s.get_unsafe( 100 ).value == 2 );
+}
+
+}
+
+TEST_CASE( "random" ) {
+  sparse_set s;
+  std::map< size_t, int > reference;
+  std::srand( 7 );
+
+  for ( int step = 0; step < 20000; ++step ) {
+    const size_t pos = static_cast< size_t >( std::rand() % 1000 );
+    if ( std::rand() % 3 ) {
+      s.set( pos, step );
+      reference[ pos ] = step;
+    } else {
+      s.erase( pos );
+      reference.erase( pos );
+    }
+  }
+
+  REQUIRE( s.size() == reference.size() );
+
+  std::vector< size_t > expected;
+  for ( const auto& kv : reference ) {
+    expected.push_back( kv.first );
+    REQUIRE( s.get_unsafe( kv.first ) == kv.second );
+  }
+
+  REQUIRE( indices( s ) == expected );
+
+  size_t visited( 0 );
+  s.for_each( [ & ]( const size_t pos, const int v ) {
+    REQUIRE( reference.at( pos ) == v );
+    ++visited;
+  } );
+  REQUIRE( visited == reference.size() );
+}
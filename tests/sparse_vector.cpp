@@ -3,6 +3,10 @@
 
 #include <sparse_vector.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 TEST_CASE( "init" ) {
 
 SECTION( "default" ) {
@@ -15,6 +19,29 @@ SECTION( "default" ) {
 
 }
 
+TEST_CASE( "layout" ) {
+
+SECTION( "index_type" ) {
+    REQUIRE( sizeof( ecs::sparse_vector< int >::index_type ) == 1 );
+    REQUIRE( sizeof( ecs::sparse_vector< int, 255 >::index_type ) == 1 );
+    REQUIRE( sizeof( ecs::sparse_vector< int, 256 >::index_type ) == 2 );
+    REQUIRE( sizeof( ecs::sparse_vector< int, 65536 >::index_type ) == 4 );
+}
+
+SECTION( "index_type_page" ) {
+    ecs::sparse_vector< int, 256 > v;
+    v.emplace( 255, 666 );
+    v.emplace( 0, 13 );
+
+    auto range = v.index_range();
+    REQUIRE( range.first == 0 );
+    REQUIRE( range.second == 255 );
+    REQUIRE( v.get_unsafe( 255 ) == 666 );
+    REQUIRE( v.get_unsafe( 0 ) == 13 );
+}
+
+}
+
 TEST_CASE( "modify" ) {
 
 SECTION( "insert" ) {
@@ -225,6 +252,27 @@ SECTION( "get_operator_not_first_page" ) {
     REQUIRE( res == 666 );
 }
 
+SECTION( "huge_indices" ) {
+    ecs::sparse_vector< int > v;
+    const size_t far = 3000000000u;
+    v.emplace( 5, 1 );
+    v.emplace( far, 2 );
+    v.emplace( far + 100000, 3 );
+
+    REQUIRE( v.get_unsafe( far ) == 2 );
+    REQUIRE( v.page_count() == ( far + 100000 ) / 64 + 1 );
+    REQUIRE( v.index_range() == std::make_pair( size_t( 5 ), far + 100000 ) );
+
+    std::vector< size_t > indices;
+    v.for_each_index( [ &indices ]( const size_t i ) { indices.push_back( i ); } );
+    REQUIRE( indices == std::vector< size_t >{ 5, far, far + 100000 } );
+
+    v.erase( far + 100000 );
+    REQUIRE( v.index_range().second == far );
+    v.erase_range( 0, far + 1 );
+    REQUIRE( v.size() == 0 );
+}
+
 }
 
 TEST_CASE( "utility" ) {
@@ -294,4 +342,348 @@ SECTION( "index_range_different_pages" ) {
     REQUIRE( range.second == 66 );
 }
 
+SECTION( "size" ) {
+    ecs::sparse_vector< int > v;
+    v.emplace( 0, 666 );
+    v.emplace( 16, 666 );
+    v.emplace( 100, 666 );
+    v.erase( 16 );
+
+    REQUIRE( v.size() == 2 );
+}
+
+SECTION( "index_range_update" ) {
+    ecs::sparse_vector< int > v;
+    v.emplace( 70, 666 );
+    v[ 5 ] = 666;
+    v.set( 1000, 666 );
+    v.emplace( 70, 667 );
+    REQUIRE( v.index_range() == std::make_pair< size_t, size_t >( 5, 1000 ) );
+    REQUIRE( v.size() == 3 );
+
+    v.erase( 5 );
+    v.erase( 1000 );
+    REQUIRE( v.index_range() == std::make_pair< size_t, size_t >( 70, 70 ) );
+
+    v.erase( 70 );
+    REQUIRE( v.index_range() == std::make_pair( v.bad_index, v.bad_index ) );
+    REQUIRE( v.size() == 0 );
+}
+
+SECTION( "emplace_range" ) {
+    ecs::sparse_vector< int > v;
+    v.emplace( 100, 1 );
+    v.emplace_range( 10, 200, 666 );
+
+    REQUIRE( v.size() == 200 );
+    REQUIRE( v.index_range() == std::make_pair< size_t, size_t >( 10, 209 ) );
+    REQUIRE( v.get_unsafe( 10 ) == 666 );
+    REQUIRE( v.get_unsafe( 100 ) == 1 );
+    REQUIRE( v.get_unsafe( 209 ) == 666 );
+}
+
+SECTION( "insert_range" ) {
+    ecs::sparse_vector< int > v;
+    const std::vector< size_t > ids{ 3, 4, 700, 5 };
+    const std::vector< int > values{ 1, 2, 3, 4 };
+    v.insert_range( ids.begin(), ids.end(), values.begin() );
+
+    REQUIRE( v.size() == 4 );
+    REQUIRE( v.index_range() == std::make_pair< size_t, size_t >( 3, 700 ) );
+    REQUIRE( v.get_unsafe( 700 ) == 3 );
+    REQUIRE( v.get_unsafe( 5 ) == 4 );
+}
+
+SECTION( "erase_range" ) {
+    ecs::sparse_vector< int > v;
+    v.emplace_range( 0, 300, 666 );
+    v.erase_range( 10, 250 );
+
+    REQUIRE( v.size() == 60 );
+    REQUIRE( v.exist( 9 ) );
+    REQUIRE( !v.exist( 10 ) );
+    REQUIRE( !v.exist( 249 ) );
+    REQUIRE( v.exist( 250 ) );
+
+    v.erase_range( 200, 1000 );
+    REQUIRE( v.index_range() == std::make_pair< size_t, size_t >( 0, 9 ) );
+
+    v.erase_range( 0, 10 );
+    REQUIRE( v.size() == 0 );
+    REQUIRE( v.index_range() == std::make_pair( v.bad_index, v.bad_index ) );
+}
+
+SECTION( "for_each_index" ) {
+    ecs::sparse_vector< int > v;
+    v.emplace( 66, 666 );
+    v.emplace( 13, 666 );
+    v.emplace( 1000, 666 );
+
+    std::vector< size_t > ids;
+    v.for_each_index( [ & ]( const size_t id ) {
+        ids.push_back( id );
+        v.erase( id );
+    } );
+
+    REQUIRE( ids == std::vector< size_t >{ 13, 66, 1000 } );
+    REQUIRE( v.size() == 0 );
+}
+
+SECTION( "mask_words" ) {
+    ecs::sparse_vector< int > v;
+    ecs::sparse_vector< int, 8 > narrow;
+    ecs::sparse_vector< int, 96 > wide;
+    for ( size_t id : { 3, 64, 70, 127, 200 } ) {
+      v.emplace( id, 0 );
+      narrow.emplace( id, 0 );
+      wide.emplace( id, 0 );
+    }
+
+    const uint64_t expected[] = { uint64_t( 1 ) << 3, 1 | ( uint64_t( 1 ) << 6 ) | ( uint64_t( 1 ) << 63 ), 0, uint64_t( 1 ) << 8, 0 };
+    uint64_t words[ 5 ];
+    v.mask_words( 0, 5, words );
+    REQUIRE( std::equal( words, words + 5, expected ) );
+    narrow.mask_words( 0, 5, words );
+    REQUIRE( std::equal( words, words + 5, expected ) );
+    wide.mask_words( 0, 5, words );
+    REQUIRE( std::equal( words, words + 5, expected ) );
+}
+
+SECTION( "sort" ) {
+    ecs::sparse_vector< int, 8, ecs::unordered_page_policy > v, w;
+    for ( size_t id = 0; id < 20; ++id ) {
+      v.emplace( id, static_cast< int >( ( id * 7 ) % 20 ) );
+      if ( id % 2 ) {
+        w.emplace( id, 0 );
+      }
+    }
+
+    v.sort( []( const int a, const int b ) { return a > b; } );
+    v.for_each_page( [ & ]( const size_t base, const int* data, const ecs::sparse_vector< int, 8, ecs::unordered_page_policy >::index_type* back_index, const size_t count ) {
+      for ( size_t i = 0; i < count; ++i ) {
+        REQUIRE( data[ i ] == static_cast< int >( ( ( base + back_index[ i ] ) * 7 ) % 20 ) );
+        if ( i ) {
+          REQUIRE( data[ i - 1 ] > data[ i ] );
+        }
+      }
+    } );
+
+    // odd ids first, in the order of v
+    w.sort_as( v );
+    v.sort_as( w );
+    v.for_each_page( [ & ]( const size_t base, const int* data, const ecs::sparse_vector< int, 8, ecs::unordered_page_policy >::index_type* back_index, const size_t count ) {
+      for ( size_t i = 0; i < count; ++i ) {
+        REQUIRE( v.get_unsafe( base + back_index[ i ] ) == data[ i ] );
+        REQUIRE( ( back_index[ i ] % 2 == 1 ) == ( i < ( count + 1 ) / 2 ) );
+        if ( i && i != ( count + 1 ) / 2 ) {
+          REQUIRE( data[ i - 1 ] > data[ i ] );
+        }
+      }
+    } );
+}
+
+SECTION( "for_each_page" ) {
+    ecs::sparse_vector< int > v;
+    v.emplace( 70, 3 );
+    v.emplace( 66, 2 );
+    v.emplace( 13, 1 );
+
+    std::vector< size_t > bases;
+    std::vector< int > values;
+    v.for_each_page( [ & ]( const size_t base, int* data, const ecs::sparse_vector< int >::index_type* back_index, const size_t count ) {
+        bases.push_back( base );
+        for ( size_t i = 0; i < count; ++i ) {
+            values.push_back( data[ i ] );
+            REQUIRE( v.get_unsafe( base + back_index[ i ] ) == data[ i ] );
+        }
+    } );
+
+    REQUIRE( bases == std::vector< size_t >{ 0, 64 } );
+    REQUIRE( values == std::vector< int >{ 1, 2, 3 } );
+}
+
+SECTION( "for_each" ) {
+    ecs::sparse_vector< int > v;
+    v.emplace( 70, 3 );
+    v.emplace( 13, 1 );
+
+    v.for_each( [ & ]( const size_t, int& value ) {
+        value *= 10;
+    } );
+
+    std::vector< size_t > ids;
+    const auto& vc = v;
+    vc.for_each( [ & ]( const size_t id, const int& ) {
+        ids.push_back( id );
+    } );
+
+    REQUIRE( ids == std::vector< size_t >{ 13, 70 } );
+    REQUIRE( v.get_unsafe( 13 ) == 10 );
+    REQUIRE( v.get_unsafe( 70 ) == 30 );
+}
+
+SECTION( "index_range_wide_page" ) {
+    ecs::sparse_vector< int, 128 > v;
+    v.emplace( 200, 666 );
+    v.emplace( 130, 666 );
+    v.emplace( 100, 666 );
+
+    auto range = v.index_range();
+
+    REQUIRE( range.first == 100 );
+    REQUIRE( range.second == 200 );
+}
+
+SECTION( "insert_reverse_order" ) {
+    ecs::sparse_vector< int > v;
+    for ( int i = 63; i >= 0; --i ) {
+        v.emplace( i, i );
+    }
+
+    std::vector< int > values;
+    v.for_each( [ & ]( const size_t id, const int& value ) {
+        REQUIRE( id == static_cast< size_t >( value ) );
+        values.push_back( value );
+    } );
+
+    REQUIRE( values.size() == 64 );
+    REQUIRE( std::is_sorted( values.begin(), values.end() ) );
+}
+
+SECTION( "copy_page" ) {
+    ecs::sparse_vector< int > src;
+    src.emplace( 3, 30 );
+    src.emplace( 1, 10 );
+    src.emplace( 70, 700 );
+
+    ecs::sparse_vector< int > dst;
+    dst.emplace( 200, 2 );
+    dst.emplace( 130, 1 );
+    dst.copy_page( src, 0, 2 );
+
+    REQUIRE( dst.size() == 3 );
+    REQUIRE( dst.index_range() == std::make_pair( size_t( 129 ), size_t( 200 ) ) );
+    REQUIRE( dst.get_unsafe( 129 ) == 10 );
+    REQUIRE( dst.get_unsafe( 131 ) == 30 );
+    REQUIRE( !dst.exist( 130 ) );
+
+    dst.copy_page( src, 5, 2 );
+    REQUIRE( dst.size() == 1 );
+    REQUIRE( dst.index_range() == std::make_pair( size_t( 200 ), size_t( 200 ) ) );
+}
+
+SECTION( "copy_from" ) {
+    ecs::sparse_vector< std::string, 64, ecs::unordered_page_policy > src;
+    src.emplace( 5, "five" );
+    src.emplace( 2, "two" );
+    src.emplace( 100, "hundred" );
+    src.erase( 5 );
+
+    ecs::sparse_vector< std::string, 64, ecs::unordered_page_policy > dst;
+    dst.emplace( 7, "seven" );
+    dst.copy_from( src );
+    src.clear();
+
+    std::vector< std::pair< size_t, std::string > > items;
+    dst.for_each( [ & ]( const size_t id, const std::string& value ) {
+        items.emplace_back( id, value );
+    } );
+
+    REQUIRE( dst.size() == 2 );
+    REQUIRE( dst.index_range() == std::make_pair( size_t( 2 ), size_t( 100 ) ) );
+    REQUIRE( items == ( std::vector< std::pair< size_t, std::string > >{ { 2, "two" }, { 100, "hundred" } } ) );
+
+    dst.erase( 2 );
+    dst.emplace( 3, "three" );
+    REQUIRE( dst.get_unsafe( 3 ) == "three" );
+}
+
+}
+
+TEST_CASE( "unordered_policy" ) {
+
+SECTION( "insert" ) {
+    ecs::sparse_vector< int, 64, ecs::unordered_page_policy > v;
+    v.emplace( 10, 13 );
+    v.emplace( 9, 666 );
+    v.emplace( 8, 100500 );
+
+    auto range = v.index_range();
+    REQUIRE( range.first == 8 );
+    REQUIRE( range.second == 10 );
+
+    std::vector< int > values;
+    v.for_each( [ & ]( const size_t, const int& value ) {
+        values.push_back( value );
+    } );
+
+    REQUIRE( values == std::vector< int >{ 13, 666, 100500 } );
+}
+
+SECTION( "erase_swaps_last" ) {
+    ecs::sparse_vector< int, 64, ecs::unordered_page_policy > v;
+    v.emplace( 10, 13 );
+    v.emplace( 9, 666 );
+    v.emplace( 8, 100500 );
+    v.erase( 10 );
+
+    REQUIRE( v.exist( 10 ) == false );
+    REQUIRE( v.get_unsafe( 9 ) == 666 );
+    REQUIRE( v.get_unsafe( 8 ) == 100500 );
+
+    std::vector< size_t > ids;
+    v.for_each( [ & ]( const size_t id, const int& ) {
+        ids.push_back( id );
+    } );
+
+    REQUIRE( ids == std::vector< size_t >{ 8, 9 } );
+}
+
+}
+
+TEST_CASE( "page_pool" ) {
+
+SECTION( "reuse" ) {
+    ecs::sparse_vector< int > v;
+    for ( int i = 0; i < 10; ++i ) {
+        v.emplace( 64, i );
+        v.erase( 64 );
+    }
+
+    REQUIRE( v.pool_stats().misses == 1 );
+    REQUIRE( v.pool_stats().hits == 9 );
+}
+
+SECTION( "no_retention" ) {
+    ecs::sparse_vector< int > v;
+    v.set_page_pool_capacity( 0 );
+    for ( int i = 0; i < 10; ++i ) {
+        v.emplace( 64, i );
+        v.erase( 64 );
+    }
+
+    REQUIRE( v.pool_stats().misses == 10 );
+    REQUIRE( v.pool_stats().hits == 0 );
+}
+
+SECTION( "clear" ) {
+    ecs::sparse_vector< int > v;
+    v.emplace( 0, 13 );
+    v.emplace( 100, 666 );
+    v.clear();
+
+    REQUIRE( v.exist( 0 ) == false );
+    REQUIRE( v.exist( 100 ) == false );
+    REQUIRE( v.size() == 0 );
+
+    v.emplace( 1000, 666 );
+    v.emplace( 10000, 666 );
+    v.emplace( 100000, 666 );
+
+    REQUIRE( v.exist( 0 ) == false );
+    REQUIRE( v.get_unsafe( 1000 ) == 666 );
+    REQUIRE( v.pool_stats().misses == 3 );
+    REQUIRE( v.pool_stats().hits == 2 );
+}
+
 }
@@ -5,6 +5,78 @@
 
 #include <storage.h>
 
+#include <algorithm>
+#include <atomic>
+
+struct Health {
+  int value;
+
+  Health( const int v ):
+    value( v ) {}
+};
+
+struct Mass {
+  float value;
+
+  Mass() {}
+  Mass( const float v ):
+    value( v ) {}
+};
+
+struct Force {
+  float x, y;
+
+  Force() {}
+  Force( const float _x, const float _y ):
+    x( _x ), y( _y ) {}
+};
+
+struct Frozen {};
+
+struct Score {
+  int value;
+
+  Score( const int v ):
+    value( v ) {}
+};
+
+struct Armor {
+  int value;
+
+  Armor( const int v ):
+    value( v ) {}
+};
+
+namespace ecs {
+  template <>
+  struct component_traits< Armor >: default_component_traits< Armor > {
+    static const size_t page_size = 8;
+    using page_policy = unordered_page_policy;
+  };
+
+  template <>
+  struct component_traits< Health >: default_component_traits< Health > {
+    static const size_t page_size = 8;
+    using page_policy = unordered_page_policy;
+  };
+
+  template <>
+  struct component_traits< Score >: default_component_traits< Score > {
+    static const size_t page_size = 8;
+    using page_policy = sparse_set_policy;
+  };
+
+  template <>
+  struct component_traits< Mass >: default_component_traits< Mass > {
+    using fields = soa_fields< soa_field< Mass, float, &Mass::value > >;
+  };
+
+  template <>
+  struct component_traits< Force >: default_component_traits< Force > {
+    using fields = soa_fields< soa_field< Force, float, &Force::x >, soa_field< Force, float, &Force::y > >;
+  };
+}
+
 TEST_CASE( "init" ) {
 
 SECTION( "default" ) {
@@ -92,6 +164,28 @@ SECTION( "remove" ) {
   REQUIRE( pc == nullptr );
 }
 
+SECTION( "component_ranges" ) {
+  ecs::components_storage s;
+  s.add_entity_component_range< Position >( 100, 1000, 1.0f, 2.0f );
+
+  const std::vector< ecs::eid_t > ids{ 150, 5000 };
+  const std::vector< Velocity > velocities{ Velocity( 1.0f, 1.0f ), Velocity( 2.0f, 2.0f ) };
+  s.insert_entity_component_range< Velocity >( ids.begin(), ids.end(), velocities.begin() );
+
+  s.remove_entity_component_range< Position >( 0, 150 );
+
+  size_t called = 0;
+  s.join< Position, Velocity >( [ & ]( const ecs::eid_t id, const Position& p, const Velocity& v ) {
+    ++called;
+    REQUIRE( id == 150 );
+    REQUIRE( p == Position( 1.0f, 2.0f ) );
+    REQUIRE( v == Velocity( 1.0f, 1.0f ) );
+  } );
+
+  REQUIRE( called == 1 );
+  REQUIRE( s.storage< Position >().size() == 950 );
+}
+
 SECTION( "remove_noexist" ) {
   ecs::components_storage s;
   s.add_entity_component< Position >( 201, 3.1415f, 2.7182f );
@@ -197,5 +291,768 @@ SECTION( "join_exclude" ) {
   REQUIRE( called == 2 );
 }
 
+SECTION( "join_sparse_driver" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t i = 0; i < 1000; ++i ) {
+    s.add_entity_component< Position >( i, 1.0f, 2.0f );
+  }
+
+  s.add_entity_component< Velocity >( 13, 1.4142f, 9.81f );
+  s.add_entity_component< Velocity >( 666, 1.4142f, 9.81f );
+  s.add_entity_component< Velocity >( 5000, 1.4142f, 9.81f );
+
+  std::vector< ecs::eid_t > ids;
+  s.join< Position, Velocity >( [ & ]( const ecs::eid_t id, const Position&, const Velocity& ) {
+    ids.push_back( id );
+  } );
+
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 13, 666 } );
+}
+
+SECTION( "join_mixed_page_sizes" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t i = 0; i < 2000; ++i ) {
+    if ( i % 3 ) {
+      s.add_entity_component< Position >( i, 1.0f, 2.0f );
+    }
+    if ( i % 5 ) {
+      s.add_entity_component< Health >( i, static_cast< int >( i ) );
+    }
+    if ( i % 7 == 0 ) {
+      s.add_entity_component< Frozen >( i );
+    }
+  }
+
+  std::vector< ecs::eid_t > ids, expected;
+  s.join< Position, Health >().exclude< Frozen >( [ & ]( const ecs::eid_t id, const Position&, const Health& h ) {
+    ids.push_back( id );
+    REQUIRE( h.value == static_cast< int >( id ) );
+  } );
+
+  for ( ecs::eid_t i = 0; i < 2000; ++i ) {
+    if ( i % 3 && i % 5 && i % 7 ) {
+      expected.push_back( i );
+    }
+  }
+
+  REQUIRE( ids == expected );
+}
+
+SECTION( "join_remove_in_callback" ) {
+  ecs::components_storage s;
+  s.add_entity_component< Position >( 1, 1.0f, 2.0f );
+  s.add_entity_component< Position >( 2, 1.0f, 2.0f );
+  s.add_entity_component< Position >( 70, 1.0f, 2.0f );
+
+  size_t called = 0;
+  s.join< Position >( [ & ]( const ecs::eid_t id, const Position& ) {
+    ++called;
+    s.remove_entity_component< Position >( id );
+  } );
+
+  REQUIRE( called == 3 );
+  REQUIRE( s.get_entity_component< Position >( 1 ) == nullptr );
+  REQUIRE( s.get_entity_component< Position >( 70 ) == nullptr );
+}
+
+SECTION( "join_exclude_empty" ) {
+  ecs::components_storage s;
+  s.add_entity_component< Position >( 200, 3.1415f, 2.7182f );
+  s.remove_entity_component< Position >( 200 );
+
+  size_t called = 0;
+  s
+    .join< Position >()
+    .exclude< Velocity >( [ & ]( const ecs::eid_t, const Position& ) {
+    ++called;
+  } );
+
+  REQUIRE( called == 0 );
+}
+
+SECTION( "join_custom_traits" ) {
+  ecs::components_storage s;
+  s.add_entity_component< Health >( 20, 3 );
+  s.add_entity_component< Health >( 17, 2 );
+  s.add_entity_component< Health >( 1, 1 );
+  s.add_entity_component< Position >( 17, 1.0f, 2.0f );
+  s.add_entity_component< Position >( 20, 1.0f, 2.0f );
+  s.remove_entity_component< Health >( 1 );
+
+  std::vector< ecs::eid_t > ids;
+  s.join< Health, Position >( [ & ]( const ecs::eid_t id, const Health& h, const Position& ) {
+    ids.push_back( id );
+    REQUIRE( h.value == ( id == 17 ? 2 : 3 ) );
+  } );
+
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 17, 20 } );
+}
+
+SECTION( "parallel_join" ) {
+  ecs::components_storage s;
+  s.add_entity_component_range< Position >( 0, 100000, 1.0f, 2.0f );
+  s.add_entity_component_range< Velocity >( 50000, 100000, 1.0f, 1.0f );
+
+  std::atomic< size_t > called( 0 );
+  s.parallel_join< Position, Velocity >( [ & ]( const ecs::eid_t, Position& p, const Velocity& v ) {
+    ++called;
+    p.x += v.x;
+  } );
+
+  REQUIRE( called == 50000 );
+  REQUIRE( s.get_entity_component< Position >( 99999 )->x == 2.0f );
+  REQUIRE( s.get_entity_component< Position >( 49999 )->x == 1.0f );
+}
+
+SECTION( "parallel_exclude_executor" ) {
+  ecs::components_storage s;
+  s.add_entity_component_range< Position >( 0, 1000, 1.0f, 2.0f );
+  s.add_entity_component_range< Velocity >( 0, 500, 1.0f, 1.0f );
+
+  size_t tasks = 0;
+  s.set_join_task_pages( 2 );
+  s.set_join_executor( [ & ]( const size_t count, const std::function< void( const size_t ) >& task ) {
+    for ( size_t i = 0; i < count; ++i ) {
+      task( i );
+    }
+
+    tasks += count;
+  } );
+
+  std::vector< ecs::eid_t > ids;
+  s
+    .join< Position >()
+    .parallel_exclude< Velocity >( [ & ]( const ecs::eid_t id, const Position& ) {
+    ids.push_back( id );
+  } );
+
+  REQUIRE( tasks == 8 );
+  REQUIRE( ids.size() == 500 );
+  REQUIRE( ids.front() == 500 );
+  REQUIRE( ids.back() == 999 );
+}
+
+SECTION( "join_huge_ids" ) {
+  // gaps between live pages are skipped rather than scanned
+  ecs::components_storage s;
+  const ecs::eid_t huge = 3000000000u;
+  s.add_entity_component< Position >( 5, 1.0f, 2.0f );
+  s.add_entity_component< Position >( huge, 1.0f, 2.0f );
+  s.add_entity_component< Velocity >( 7, 1.0f, 1.0f );
+  s.add_entity_component< Velocity >( huge, 1.0f, 1.0f );
+
+  std::vector< ecs::eid_t > ids;
+  s.join< Position >( [ & ]( const ecs::eid_t id, const Position& ) { ids.push_back( id ); } );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 5, huge } );
+
+  size_t tasks = 0;
+  s.set_join_executor( [ & ]( const size_t count, const std::function< void( const size_t ) >& task ) {
+    for ( size_t i = 0; i < count; ++i ) {
+      task( i );
+    }
+
+    tasks += count;
+  } );
+
+  ids.clear();
+  s.parallel_join< Position, Velocity >( [ & ]( const ecs::eid_t id, const Position&, const Velocity& ) { ids.push_back( id ); } );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ huge } );
+  REQUIRE( tasks == 2 );
+}
+
+SECTION( "soa_components" ) {
+  ecs::components_storage s;
+  s.add_entity_component< Mass >( 10, 2.0f );
+  s.set_entity_component< Mass >( 11, Mass( 4.0f ) );
+  s.add_entity_component< Mass >( 70, 8.0f );
+  s.add_entity_component< Force >( 11, 1.0f, 2.0f );
+  s.add_entity_component< Force >( 70, 3.0f, 4.0f );
+  s.add_entity_component< Force >( 71, 5.0f, 6.0f );
+  s.remove_all_components( 70 );
+
+  size_t matched = 0;
+  s.join_fields< Mass, Force >( [ & ]( const ecs::eid_t base, const uint64_t* mask, std::tuple< float* > m, std::tuple< float*, float* > f ) {
+    for ( size_t i = 0; i < 64; ++i ) {
+      if ( ( mask[ 0 ] >> i ) & 1 ) {
+        ++matched;
+        REQUIRE( base + i == 11 );
+        std::get< 0 >( f )[ i ] /= std::get< 0 >( m )[ i ];
+      }
+    }
+  } );
+
+  REQUIRE( matched == 1 );
+  REQUIRE( s.storage< Force >().get( 11 ).x == 0.25f );
+  REQUIRE( s.storage< Mass >().exist( 70 ) == false );
+}
+
+SECTION( "soa_huge_ids" ) {
+  ecs::components_storage s;
+  const ecs::eid_t huge = 3000000000u;
+  s.add_entity_component< Mass >( 3, 2.0f );
+  s.add_entity_component< Mass >( huge, 4.0f );
+  s.add_entity_component< Force >( huge, 1.0f, 2.0f );
+  s.add_entity_component< Force >( huge + 64, 1.0f, 2.0f );
+
+  std::vector< ecs::eid_t > bases;
+  s.join_fields< Mass, Force >( [ & ]( const ecs::eid_t base, const uint64_t* mask, std::tuple< float* >, std::tuple< float*, float* > ) {
+    bases.push_back( base );
+    REQUIRE( mask[ 0 ] == uint64_t( 1 ) << ( huge - base ) );
+  } );
+
+  REQUIRE( bases == std::vector< ecs::eid_t >{ huge / 64 * 64 } );
+}
+
+SECTION( "tag_components" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t i = 0; i < 100; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( i ) );
+  }
+
+  s.add_entity_component_range< Frozen >( 10, 20 );
+  s.add_entity_component< Frozen >( 500 );
+  s.remove_entity_component< Frozen >( 15 );
+  REQUIRE( s.storage< Frozen >().size() == 20 );
+  REQUIRE( s.get_entity_component< Frozen >( 10 ) );
+  REQUIRE( !s.get_entity_component< Frozen >( 15 ) );
+
+  size_t frozen = 0;
+  s.join< Health, Frozen >( [ & ]( const ecs::eid_t id, Health&, Frozen& ) {
+    ++frozen;
+    REQUIRE( id >= 10 );
+    REQUIRE( id < 30 );
+  } );
+
+  size_t thawed = 0;
+  s.join< Health >().exclude< Frozen >( [ & ]( const ecs::eid_t, Health& ) { ++thawed; } );
+
+  REQUIRE( frozen == 19 );
+  REQUIRE( thawed == 81 );
+}
+
+}
+
+TEST_CASE( "query" ) {
+
+SECTION( "membership" ) {
+  ecs::components_storage s;
+  s.add_entity_component< Position >( 1, 1.0f, 2.0f );
+  s.add_entity_component< Position >( 2, 1.0f, 2.0f );
+  s.add_entity_component< Velocity >( 2, 1.0f, 2.0f );
+
+  auto& q = s.query< Position, Velocity >();
+  REQUIRE( &q == &s.query< Position, Velocity >() );
+  REQUIRE( q.ids() == ecs::query_base::id_vector{ 2 } );
+
+  s.set_entity_component< Velocity >( 1, Velocity( 3.0f, 4.0f ) );
+  s.add_entity_component_range< Position >( 10, 5, 1.0f, 2.0f );
+  s.add_entity_component_range< Velocity >( 10, 5, 1.0f, 2.0f );
+  REQUIRE( q.size() == 7 );
+
+  s.remove_entity_component< Position >( 2 );
+  s.remove_all_components( 1 );
+  s.remove_entity_component_range< Velocity >( 12, 100 );
+  REQUIRE( q.size() == 2 );
+  REQUIRE( q.contains( 10 ) );
+  REQUIRE( q.contains( 11 ) );
+}
+
+SECTION( "each" ) {
+  ecs::components_storage s;
+  s.add_entity_component_range< Position >( 0, 100, 1.0f, 2.0f );
+  s.add_entity_component_range< Velocity >( 0, 100, 1.0f, 2.0f );
+
+  auto& q = s.query< Position, Velocity >();
+
+  size_t called = 0;
+  q.each( [ & ]( const ecs::eid_t id, Position& p, const Velocity& v ) {
+    ++called;
+    p.x += v.x;
+    if ( id % 2 ) {
+      s.remove_entity_component< Velocity >( id );
+    }
+  } );
+
+  REQUIRE( called == 100 );
+  REQUIRE( q.size() == 50 );
+  REQUIRE( s.get_entity_component< Position >( 99 )->x == 2.0f );
+}
+
+SECTION( "archetype_backend" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  s.add_entity_component< Position >( 1, 1.0f, 2.0f );
+
+  auto& q = s.query< Position, Velocity >();
+  REQUIRE( q.size() == 0 );
+
+  s.add_entity_component< Velocity >( 1, 1.0f, 2.0f );
+  REQUIRE( q.ids() == ecs::query_base::id_vector{ 1 } );
+
+  size_t called = 0;
+  q.each( [ & ]( const ecs::eid_t, const Position& p, const Velocity& ) {
+    ++called;
+    REQUIRE( p == Position( 1.0f, 2.0f ) );
+  } );
+
+  REQUIRE( called == 1 );
+}
+
+}
+
+TEST_CASE( "group" ) {
+
+SECTION( "membership" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t i = 0; i < 40; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( i ) );
+    if ( i % 3 == 0 ) {
+      s.add_entity_component< Armor >( i, static_cast< int >( i ) * 10 );
+    }
+  }
+
+  auto& g = s.group< Health, Armor >();
+  REQUIRE( &g == &s.group< Health, Armor >() );
+  REQUIRE( g.size() == 14 );
+
+  s.add_entity_component< Armor >( 1, 10 );
+  s.remove_entity_component< Health >( 3 );
+  s.remove_all_components( 6 );
+  s.remove_entity_component_range< Armor >( 30, 40 );
+  REQUIRE( g.size() == 9 );
+  REQUIRE( g.contains( 1 ) );
+  REQUIRE( !g.contains( 3 ) );
+  REQUIRE( !g.contains( 33 ) );
+
+  std::vector< ecs::eid_t > ids;
+  g.each( [ & ]( const ecs::eid_t id, const Health& h, const Armor& a ) {
+    ids.push_back( id );
+    REQUIRE( h.value == static_cast< int >( id ) );
+    REQUIRE( a.value == static_cast< int >( id ) * 10 );
+  } );
+
+  std::sort( ids.begin(), ids.end() );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 0, 1, 9, 12, 15, 18, 21, 24, 27 } );
+
+  // non-members are still reachable
+  REQUIRE( s.get_entity_component< Health >( 2 )->value == 2 );
+  REQUIRE( s.get_entity_component< Armor >( 30 ) == nullptr );
+}
+
+SECTION( "remove_in_each" ) {
+  ecs::components_storage s;
+  auto& g = s.group< Health, Armor >();
+  for ( ecs::eid_t i = 0; i < 100; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( i ) );
+    s.add_entity_component< Armor >( i, static_cast< int >( i ) * 10 );
+  }
+
+  size_t called = 0;
+  g.each( [ & ]( const ecs::eid_t id, const Health& h, const Armor& a ) {
+    ++called;
+    REQUIRE( a.value == h.value * 10 );
+    if ( id % 2 ) {
+      s.remove_entity_component< Armor >( id );
+    }
+  } );
+
+  REQUIRE( called == 100 );
+  REQUIRE( g.size() == 50 );
+
+  size_t joined = 0;
+  s.join< Health, Armor >( [ & ]( const ecs::eid_t id, const Health& h, const Armor& a ) {
+    ++joined;
+    REQUIRE( id % 2 == 0 );
+    REQUIRE( a.value == h.value * 10 );
+  } );
+
+  REQUIRE( joined == 50 );
+}
+
+SECTION( "huge_ids" ) {
+  ecs::components_storage s;
+  auto& g = s.group< Health, Armor >();
+  const ecs::eid_t huge = 3000000000u;
+  for ( ecs::eid_t id : { ecs::eid_t( 2 ), ecs::eid_t( 5 ), huge, huge + 1 } ) {
+    s.add_entity_component< Health >( id, static_cast< int >( id % 100 ) );
+    s.add_entity_component< Armor >( id, 1 );
+  }
+
+  g.sort( []( const Health& a, const Health& b ) { return a.value > b.value; } );
+
+  std::vector< ecs::eid_t > ids;
+  g.each( [ & ]( const ecs::eid_t id, const Health&, const Armor& ) { ids.push_back( id ); } );
+  std::sort( ids.begin(), ids.end() );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 2, 5, huge, huge + 1 } );
+
+  s.remove_entity_component_range< Armor >( huge, huge + 8 );
+  REQUIRE( g.size() == 2 );
+  REQUIRE( !g.contains( huge ) );
+  REQUIRE( g.contains( 5 ) );
+}
+
+}
+
+TEST_CASE( "change_versions" ) {
+
+SECTION( "join_changed" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t i = 0; i < 32; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( i ) );
+  }
+
+  const uint64_t frame = s.tick();
+  REQUIRE( s.advance_tick() == frame + 1 );
+
+  // const access and const joins are not modifications
+  REQUIRE( static_cast< const ecs::components_storage& >( s ).get_entity_component< Health >( 3 ) );
+  s.join< Health >( []( const ecs::eid_t, const Health& ) {} );
+
+  size_t called = 0;
+  s.join_changed< Health >( frame, [ & ]( const ecs::eid_t, const Health& ) { ++called; } );
+  REQUIRE( called == 0 );
+
+  s.get_entity_component< Health >( 3 )->value = 30;
+  s.set_entity_component< Health >( 17, Health( 170 ) );
+
+  // pages of 8, untouched ones are skipped
+  std::vector< ecs::eid_t > ids;
+  s.join_changed< Health >( frame, [ & ]( const ecs::eid_t id, const Health& ) { ids.push_back( id ); } );
+  std::sort( ids.begin(), ids.end() );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 0, 1, 2, 3, 4, 5, 6, 7, 16, 17, 18, 19, 20, 21, 22, 23 } );
+
+  // a join writing a component stamps it
+  const uint64_t next = s.tick();
+  s.advance_tick();
+  s.join< Health >( []( const ecs::eid_t id, Health& h ) {
+    if ( id == 25 ) {
+      h.value = 250;
+    }
+  } );
+
+  called = 0;
+  s.join_changed< Health >( next, [ & ]( const ecs::eid_t, const Health& ) { ++called; } );
+  REQUIRE( called == 32 );
+}
+
+SECTION( "slot_versions" ) {
+  ecs::components_storage s;
+  s.storage< Health >().track_slot_versions( true );
+  for ( ecs::eid_t i = 0; i < 32; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( i ) );
+    s.add_entity_component< Armor >( i, static_cast< int >( i ) );
+  }
+
+  const uint64_t frame = s.tick();
+  s.advance_tick();
+  s.get_entity_component< Health >( 5 )->value = 50;
+  s.remove_entity_component< Armor >( 9 );
+  s.get_entity_component< Health >( 9 )->value = 90;
+  s.get_entity_component< Health >( 12 )->value = 120;
+
+  std::vector< ecs::eid_t > ids;
+  s.join_changed< Health, Armor >( frame, [ & ]( const ecs::eid_t id, const Health& h, const Armor& ) {
+    ids.push_back( id );
+    REQUIRE( h.value == static_cast< int >( id ) * 10 );
+  } );
+  std::sort( ids.begin(), ids.end() );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 5, 12 } );
+}
+
+SECTION( "range_add" ) {
+  ecs::components_storage s;
+  s.storage< Health >().track_slot_versions( true );
+  for ( ecs::eid_t i = 0; i < 8; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( i ) );
+  }
+  s.add_entity_component< Health >( 10, 10 );
+
+  const uint64_t frame = s.tick();
+  s.advance_tick();
+  s.add_entity_component_range< Health >( 0, 16, 0 );
+
+  // existing components are left intact and unstamped
+  std::vector< ecs::eid_t > ids;
+  s.join_changed< Health >( frame, [ & ]( const ecs::eid_t id, const Health& h ) {
+    ids.push_back( id );
+    REQUIRE( h.value == 0 );
+  } );
+  std::sort( ids.begin(), ids.end() );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ 8, 9, 11, 12, 13, 14, 15 } );
+}
+
+SECTION( "huge_ids" ) {
+  ecs::components_storage s;
+  const ecs::eid_t huge = 3000000000u;
+  s.add_entity_component< Health >( 1, 1 );
+  s.add_entity_component< Health >( huge, 2 );
+
+  const uint64_t frame = s.tick();
+  s.advance_tick();
+  s.get_entity_component< Health >( huge )->value = 3;
+
+  std::vector< ecs::eid_t > ids;
+  s.join_changed< Health >( frame, [ & ]( const ecs::eid_t id, const Health& ) { ids.push_back( id ); } );
+  REQUIRE( ids == std::vector< ecs::eid_t >{ huge } );
+}
+
+SECTION( "soa_components" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t id : { ecs::eid_t( 1 ), ecs::eid_t( 70 ), ecs::eid_t( 200 ) } ) {
+    s.add_entity_component< Mass >( id, 1.0f );
+    s.add_entity_component< Force >( id, 1.0f, 1.0f );
+  }
+
+  const uint64_t frame = s.tick();
+  s.advance_tick();
+  s.set_entity_component< Mass >( 70, Mass( 2.0f ) );
+
+  std::vector< ecs::eid_t > bases;
+  const auto collect = [ & ]( const ecs::eid_t base, const uint64_t*, std::tuple< const float* >, std::tuple< const float*, const float* > ) {
+    bases.push_back( base );
+  };
+
+  s.join_changed< Mass, Force >( frame, collect );
+  REQUIRE( bases == std::vector< ecs::eid_t >{ 64 } );
+
+  // only fields taken by non-const pointers are written
+  const uint64_t next = s.tick();
+  s.advance_tick();
+  s.join_fields< Mass, Force >( []( const ecs::eid_t, const uint64_t*, std::tuple< const float* > m, std::tuple< float*, float* > f ) {
+    std::get< 0 >( f )[ 0 ] = std::get< 0 >( m )[ 0 ];
+  } );
+
+  bases.clear();
+  s.join_changed< Mass, Force >( next, collect );
+  REQUIRE( bases.empty() );
+
+  s.join_changed< Force, Mass >( next, [ & ]( const ecs::eid_t base, const uint64_t*, std::tuple< const float*, const float* >, std::tuple< const float* > ) {
+    bases.push_back( base );
+  } );
+  REQUIRE( bases == std::vector< ecs::eid_t >{ 0, 64, 192 } );
+}
+
+}
+
+TEST_CASE( "signals" ) {
+
+SECTION( "add_replace_remove" ) {
+  ecs::components_storage s;
+  std::vector< ecs::eid_t > added, replaced, removed;
+  s.on_add< Health >().connect( [ & ]( const ecs::eid_t id ) {
+    added.push_back( id );
+    REQUIRE( s.get_entity_component< Health >( id ) );
+  } );
+  s.on_replace< Health >().connect( [ & ]( const ecs::eid_t id ) { replaced.push_back( id ); } );
+  const size_t connection = s.on_remove< Health >().connect( [ & ]( const ecs::eid_t id ) {
+    removed.push_back( id );
+    REQUIRE( s.get_entity_component< Health >( id ) );
+  } );
+
+  s.add_entity_component< Health >( 1, 1 );
+  s.add_entity_component< Health >( 1, 2 );
+  s.set_entity_component< Health >( 2, Health( 2 ) );
+  s.set_entity_component< Health >( 2, Health( 3 ) );
+  s.add_entity_component< Armor >( 2, 2 );
+  s.add_entity_component_range< Health >( 0, 4, 0 );
+  s.remove_entity_component< Health >( 1 );
+  s.remove_entity_component< Health >( 1 );
+  s.remove_all_components( 2 );
+  s.remove_entity_component_range< Health >( 0, 100 );
+
+  // the second add of 1 is a no-op and fires nothing
+  REQUIRE( added == std::vector< ecs::eid_t >{ 1, 2, 0, 3 } );
+  REQUIRE( replaced == std::vector< ecs::eid_t >{ 2 } );
+  REQUIRE( removed == std::vector< ecs::eid_t >{ 1, 2, 0, 3 } );
+
+  s.on_remove< Health >().disconnect( connection );
+  s.add_entity_component< Health >( 5, 5 );
+  s.remove_entity_component< Health >( 5 );
+  REQUIRE( removed.size() == 4 );
+  REQUIRE( s.on_remove< Health >().empty() );
+}
+
+SECTION( "soa_components" ) {
+  ecs::components_storage s;
+  size_t added( 0 ), removed( 0 );
+  s.on_add< Mass >().connect( [ & ]( const ecs::eid_t ) { ++added; } );
+  s.on_remove< Mass >().connect( [ & ]( const ecs::eid_t ) { ++removed; } );
+
+  s.add_entity_component_range< Mass >( 10, 100, 1.0f );
+  s.remove_entity_component_range< Mass >( 50, 200 );
+  REQUIRE( added == 100 );
+  REQUIRE( removed == 60 );
+}
+
+SECTION( "archetype_backend" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  std::vector< ecs::eid_t > added, replaced, removed;
+  s.on_add< Health >().connect( [ & ]( const ecs::eid_t id ) { added.push_back( id ); } );
+  s.on_replace< Health >().connect( [ & ]( const ecs::eid_t id ) { replaced.push_back( id ); } );
+  s.on_remove< Health >().connect( [ & ]( const ecs::eid_t id ) { removed.push_back( id ); } );
+
+  s.add_entity_component< Health >( 1, 1 );
+  s.add_entity_component< Armor >( 1, 1 );
+  s.add_entity_component< Health >( 1, 3 );
+  s.set_entity_component< Health >( 1, Health( 2 ) );
+  s.add_entity_component< Health >( 2, 2 );
+  s.remove_all_components( 1 );
+  s.remove_entity_component< Health >( 2 );
+
+  REQUIRE( added == std::vector< ecs::eid_t >{ 1, 2 } );
+  REQUIRE( replaced == std::vector< ecs::eid_t >{ 1 } );
+  REQUIRE( removed == std::vector< ecs::eid_t >{ 1, 2 } );
+}
+
+}
+
+TEST_CASE( "sort" ) {
+
+SECTION( "sort_as" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t i = 0; i < 64; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( ( i * 13 ) % 64 ) );
+    s.add_entity_component< Armor >( i, static_cast< int >( i ) );
+  }
+
+  s.sort< Health >( []( const Health& a, const Health& b ) { return a.value < b.value; } );
+  s.sort_as< Health, Armor >();
+
+  std::vector< ecs::eid_t > health, armor;
+  s.storage< Health >().for_each( [ & ]( const size_t id, const Health& ) { health.push_back( static_cast< ecs::eid_t >( id ) ); } );
+  s.storage< Armor >().for_each( [ & ]( const size_t id, const Armor& a ) {
+    armor.push_back( static_cast< ecs::eid_t >( id ) );
+    REQUIRE( a.value == static_cast< int >( id ) );
+  } );
+
+  REQUIRE( health == armor );
+  for ( size_t i = 1; i < health.size(); ++i ) {
+    if ( i % 8 ) {
+      REQUIRE( s.get_entity_component< Health >( health[ i - 1 ] )->value < s.get_entity_component< Health >( health[ i ] )->value );
+    }
+  }
+}
+
+SECTION( "group" ) {
+  ecs::components_storage s;
+  auto& g = s.group< Health, Armor >();
+  for ( ecs::eid_t i = 0; i < 64; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( ( i * 13 ) % 64 ) );
+    if ( i % 4 ) {
+      s.add_entity_component< Armor >( i, static_cast< int >( i ) );
+    }
+  }
+
+  g.sort( []( const Health& a, const Health& b ) { return a.value > b.value; } );
+
+  std::vector< int > values;
+  g.each( [ & ]( const ecs::eid_t id, const Health& h, const Armor& a ) {
+    REQUIRE( h.value == static_cast< int >( ( id * 13 ) % 64 ) );
+    REQUIRE( a.value == static_cast< int >( id ) );
+    values.push_back( h.value );
+  } );
+
+  // each walks pages of 6 members backwards
+  REQUIRE( values.size() == 48 );
+  for ( size_t i = 1; i < values.size(); ++i ) {
+    if ( i % 6 ) {
+      REQUIRE( values[ i - 1 ] < values[ i ] );
+    }
+  }
+}
+
+}
+
+TEST_CASE( "join_batch" ) {
+
+SECTION( "sparse" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t i = 0; i < 64; ++i ) {
+    s.add_entity_component< Health >( i, static_cast< int >( i ) );
+    if ( i != 20 ) {
+      s.add_entity_component< Armor >( i, 1 );
+    }
+  }
+
+  std::vector< ecs::eid_t > visited;
+  size_t runs( 0 );
+  s.join_batch< Health, Armor >( [ & ]( const ecs::eid_t* ids, Health* h, const Armor* a, const size_t n ) {
+    REQUIRE( n <= 8 );
+    for ( size_t i = 0; i < n; ++i ) {
+      REQUIRE( h[ i ].value == static_cast< int >( ids[ i ] ) );
+      h[ i ].value += a[ i ].value;
+      visited.push_back( ids[ i ] );
+    }
+    ++runs;
+  } );
+
+  // page 2 is split around the missing armor
+  REQUIRE( visited.size() == 63 );
+  REQUIRE( runs == 9 );
+  for ( ecs::eid_t i = 0; i < 64; ++i ) {
+    REQUIRE( s.get_entity_component< Health >( i )->value == static_cast< int >( i + ( i != 20 ? 1 : 0 ) ) );
+  }
+}
+
+SECTION( "archetype" ) {
+  ecs::components_storage s( ecs::storage_backend::archetype );
+  for ( ecs::eid_t i = 0; i < 100; ++i ) {
+    s.add_entity_component< Position >( i, static_cast< float >( i ), 0.0f );
+    if ( i % 2 ) {
+      s.add_entity_component< Velocity >( i, 1.0f, 1.0f );
+    }
+  }
+
+  size_t count( 0 );
+  s.join_batch< Position, Velocity >( [ & ]( const ecs::eid_t* ids, Position* p, const Velocity* v, const size_t n ) {
+    for ( size_t i = 0; i < n; ++i ) {
+      REQUIRE( ids[ i ] % 2 == 1 );
+      p[ i ].y += v[ i ].y;
+    }
+    count += n;
+  } );
+
+  REQUIRE( count == 50 );
+  for ( ecs::eid_t i = 0; i < 100; ++i ) {
+    REQUIRE( s.get_entity_component< Position >( i )->y == ( i % 2 ? 1.0f : 0.0f ) );
+  }
+}
+
+}
+
+TEST_CASE( "sparse_set_components" ) {
+  ecs::components_storage s;
+  for ( ecs::eid_t i = 0; i < 100; ++i ) {
+    s.add_entity_component< Score >( i, static_cast< int >( i ) );
+    if ( i % 3 == 0 ) {
+      s.add_entity_component< Health >( i, 1 );
+    }
+  }
+
+  s.remove_entity_component_range< Score >( 10, 20 );
+  s.remove_entity_component< Score >( 30 );
+  REQUIRE( s.storage< Score >().size() == 89 );
+
+  size_t count( 0 );
+  s.join< Health, Score >( [ & ]( const ecs::eid_t id, const Health&, Score& score ) {
+    REQUIRE( score.value == static_cast< int >( id ) );
+    score.value = -score.value;
+    ++count;
+  } );
+
+  // multiples of 3 below 100 are 34, minus 12, 15, 18 and 30
+  REQUIRE( count == 30 );
+  REQUIRE( s.get_entity_component< Score >( 33 )->value == -33 );
+  REQUIRE( s.get_entity_component< Score >( 34 )->value == 34 );
+
+  const uint64_t since = s.tick();
+  s.advance_tick();
+  s.set_entity_component< Score >( 95, Score( 0 ) );
+
+  std::vector< ecs::eid_t > changed;
+  s.join_changed< Score >( since, [ & ]( const ecs::eid_t id, const Score& ) { changed.push_back( id ); } );
+  REQUIRE( changed == std::vector< ecs::eid_t >{ 88, 89, 90, 91, 92, 93, 94, 95 } );
 
+  s.remove_all_components( 95 );
+  REQUIRE( s.get_entity_component< Score >( 95 ) == nullptr );
+  REQUIRE( s.get_entity_component< Score >( 97 )->value == 97 );
 }
\ No newline at end of file
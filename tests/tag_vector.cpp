@@ -0,0 +1,144 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <tag_vector.h>
+
+#include <set>
+#include <vector>
+
+namespace {
+
+struct Selected {};
+
+using tag_vector = ecs::tag_vector< Selected, 64 >;
+
+std::vector< size_t > indices( const tag_vector& v, const size_t first = 0, const size_t last = tag_vector::bad_index ) {
+  std::vector< size_t > result;
+  v.for_each_index( first, last, [ &result ]( const size_t i ) { result.push_back( i ); } );
+  return result;
+}
+
+}
+
+TEST_CASE( "modify" ) {
+
+SECTION( "insert_erase" ) {
+    tag_vector v;
+    REQUIRE( v.index_range().first == v.bad_index );
+
+    v.emplace( 70 );
+    v.emplace( 70 );
+    v.insert( 5000, Selected() );
+    v.set( 3, Selected() );
+
+    REQUIRE( v.size() == 3 );
+    REQUIRE( v.exist( 70 ) );
+    REQUIRE( !v.exist( 71 ) );
+    REQUIRE( !v.exist( 100000 ) );
+    REQUIRE( v.index_range() == std::make_pair< size_t, size_t >( 3, 5000 ) );
+    REQUIRE( &v.get_unsafe( 3 ) == &v.get_unsafe( 70 ) );
+
+    v.erase( 5000 );
+    v.erase( 5000 );
+    v.erase( 100000 );
+    REQUIRE( v.size() == 2 );
+    REQUIRE( v.index_range() == std::make_pair< size_t, size_t >( 3, 70 ) );
+
+    v.clear();
+    REQUIRE( v.size() == 0 );
+    REQUIRE( !v.exist( 3 ) );
+}
+
+SECTION( "ranges" ) {
+    tag_vector v;
+    v.emplace( 10 );
+    v.emplace_range( 5, 200 );
+    REQUIRE( v.size() == 200 );
+    REQUIRE( v.index_range() == std::make_pair< size_t, size_t >( 5, 204 ) );
+    uint64_t words[ 2 ];
+    v.mask_words( 1, 2, words );
+    REQUIRE( words[ 0 ] == ~uint64_t( 0 ) );
+    REQUIRE( words[ 1 ] == ~uint64_t( 0 ) );
+
+    v.erase_range( 7, 190 );
+    REQUIRE( v.size() == 17 );
+    REQUIRE( indices( v, 0, 10 ) == std::vector< size_t >{ 5, 6 } );
+    v.mask_words( 0, 2, words );
+    REQUIRE( words[ 0 ] == ( uint64_t( 3 ) << 5 ) );
+    REQUIRE( words[ 1 ] == 0 );
+
+    const std::vector< size_t > ids{ 1, 300, 9000 };
+    const std::vector< Selected > values( 3 );
+    v.insert_range( ids.begin(), ids.end(), values.begin() );
+    REQUIRE( v.size() == 20 );
+    REQUIRE( indices( v, 250 ) == std::vector< size_t >{ 300, 9000 } );
+}
+
+}
+
+TEST_CASE( "access" ) {
+
+SECTION( "for_each_index" ) {
+    tag_vector v;
+    std::set< size_t > expected;
+    for ( size_t i = 0; i < 20000; i += 37 ) {
+      v.emplace( i );
+      expected.insert( i );
+    }
+
+    const auto all = indices( v );
+    REQUIRE( std::vector< size_t >( expected.begin(), expected.end() ) == all );
+
+    // erase while iterating
+    size_t visited = 0;
+    v.for_each_index( [ & ]( const size_t i ) {
+      ++visited;
+      v.erase( i );
+      v.erase( i + 37 );
+    } );
+
+    REQUIRE( visited == ( all.size() + 1 ) / 2 );
+    REQUIRE( v.size() == 0 );
+}
+
+SECTION( "versions" ) {
+    tag_vector v;
+    v.emplace_range( 0, 256 );
+    v.touch( 70, 5 );
+    REQUIRE( v.version( 64 ) == 5 );
+    REQUIRE( v.page_version( 0 ) == 0 );
+    REQUIRE( v.page_version( 100 ) == 0 );
+
+    v.touch_all( 7 );
+    REQUIRE( v.version( 0 ) == 7 );
+}
+
+SECTION( "huge_indices" ) {
+    // blocks exist only where tags are, so this takes two of them
+    tag_vector v;
+    const size_t huge = 3000000000u;
+    v.emplace( 5 );
+    v.emplace( huge );
+    v.touch( huge, 3 );
+
+    REQUIRE( v.size() == 2 );
+    REQUIRE( v.exist( huge ) );
+    REQUIRE( !v.exist( huge - 1 ) );
+    REQUIRE( v.index_range() == std::make_pair( size_t( 5 ), huge ) );
+    REQUIRE( indices( v ) == std::vector< size_t >{ 5, huge } );
+    REQUIRE( v.version( huge ) == 3 );
+    REQUIRE( v.page_version( 7 ) == 0 );
+
+    uint64_t words[ 2 ];
+    v.mask_words( huge / 64, 2, words );
+    REQUIRE( words[ 0 ] == uint64_t( 1 ) << ( huge % 64 ) );
+    REQUIRE( words[ 1 ] == 0 );
+
+    v.erase( 5 );
+    REQUIRE( v.index_range() == std::make_pair( huge, huge ) );
+    v.erase_range( huge - 100, huge + 100 );
+    REQUIRE( v.size() == 0 );
+    REQUIRE( indices( v ).empty() );
+}
+
+}
@@ -0,0 +1,57 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <thread_pool.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE( "run" ) {
+
+SECTION( "all_tasks" ) {
+    ecs::thread_pool pool( 4 );
+    REQUIRE( pool.thread_count() == 4 );
+
+    std::vector< std::atomic< int > > hits( 1000 );
+    for ( auto& h : hits ) {
+        h = 0;
+    }
+
+    for ( int pass = 0; pass < 3; ++pass ) {
+        pool.run( hits.size(), [ & ]( const size_t i ) {
+            ++hits[ i ];
+        } );
+    }
+
+    for ( const auto& h : hits ) {
+        REQUIRE( h == 3 );
+    }
+}
+
+SECTION( "no_workers" ) {
+    ecs::thread_pool pool( 1 );
+
+    size_t sum = 0;
+    pool.run( 10, [ & ]( const size_t i ) {
+        sum += i;
+    } );
+
+    REQUIRE( sum == 45 );
+}
+
+SECTION( "exception" ) {
+    ecs::thread_pool pool( 4 );
+
+    std::atomic< size_t > called( 0 );
+    REQUIRE_THROWS_AS( pool.run( 100, [ & ]( const size_t i ) {
+        ++called;
+        if ( i == 50 ) {
+            throw std::runtime_error( "task failed" );
+        }
+    } ), std::runtime_error );
+
+    REQUIRE( called == 100 );
+}
+
+}